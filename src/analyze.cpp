@@ -0,0 +1,298 @@
+#include "analyze.h"
+#include "board.h"
+#include "search.h"
+#include "tt.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Analyze {
+
+  // Pipeline: reader -> jobs queue -> workers -> reorder window -> writer.
+  // Both hand-overs are bounded, so memory stays constant however long the input is.
+  constexpr size_t QUEUE_PER_WORKER  = 64;
+  constexpr size_t WINDOW_PER_WORKER = 64;
+  constexpr int    DEFAULT_DEPTH     = 8;
+
+  // Blocking FIFO with a fixed capacity: push waits while full, pop waits while empty
+  template <typename T>
+  class BoundedQueue {
+  public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    void push(T item) {
+      std::unique_lock<std::mutex> lock(mutex);
+      notFull.wait(lock, [&] { return items.size() < capacity; });
+      items.push_back(std::move(item));
+      notEmpty.notify_one();
+    }
+
+    // False once the queue is closed and drained
+    bool pop(T& out) {
+      std::unique_lock<std::mutex> lock(mutex);
+      notEmpty.wait(lock, [&] { return !items.empty() || closed; });
+      if (items.empty())
+        return false;
+      out = std::move(items.front());
+      items.pop_front();
+      notFull.notify_one();
+      return true;
+    }
+
+    void close() {
+      std::lock_guard<std::mutex> lock(mutex);
+      closed = true;
+      notEmpty.notify_all();
+    }
+
+  private:
+    std::mutex              mutex;
+    std::condition_variable notFull, notEmpty;
+    std::deque<T>           items;
+    size_t                  capacity;
+    bool                    closed = false;
+  };
+
+  // Results arrive out of order; this hands them to the writer in sequence. A worker whose result
+  // is more than 'window' ahead of the writer waits, which bounds the buffer. Workers take jobs in
+  // FIFO order, so the result the writer needs is always held by a worker that isn't waiting.
+  class ReorderWindow {
+  public:
+    explicit ReorderWindow(size_t window) : slots(window) {}
+
+    void put(uint64_t seq, std::string result) {
+      std::unique_lock<std::mutex> lock(mutex);
+      slotFree.wait(lock, [&] { return seq < next + slots.size(); });
+      slots[seq % slots.size()] = std::move(result);
+      if (seq == next)
+        ready.notify_one();
+    }
+
+    // Next result in sequence; false once all 'total' results have been taken
+    bool take(std::string& out) {
+      std::unique_lock<std::mutex> lock(mutex);
+      ready.wait(lock, [&] { return slots[next % slots.size()] || next == total; });
+      if (next == total)
+        return false;
+      out = std::move(*slots[next % slots.size()]);
+      slots[next % slots.size()].reset();
+      ++next;
+      slotFree.notify_all();
+      return true;
+    }
+
+    // Called by the reader once the input is exhausted
+    void finish(uint64_t count) {
+      std::lock_guard<std::mutex> lock(mutex);
+      total = count;
+      ready.notify_one();
+    }
+
+  private:
+    std::mutex                              mutex;
+    std::condition_variable                 slotFree, ready;
+    std::vector<std::optional<std::string>> slots;
+    uint64_t                                next  = 0;
+    uint64_t                                total = UINT64_MAX;
+  };
+
+  struct Job {
+    uint64_t    seq    = 0;
+    uint64_t    lineNo = 0;
+    std::string line;
+  };
+
+  static std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+      if      (c == '"' || c == '\\') { out += '\\'; out += c; }
+      else if (c == '\t')             out += "\\t";
+      else if (uint8_t(c) >= 0x20)    out += c;
+    }
+    return out;
+  }
+
+  // Split a FEN or EPD line into the position and, for EPD, its id and limit opcodes.
+  // FEN move counters are accepted; EPD operations are "opcode operand;" pairs after the 4th field.
+  static std::string parseLine(const std::string& line, Search::Limits& limits, std::string& id) {
+    std::istringstream is(line);
+    std::string fields[4], fen;
+    for (auto& f : fields) {
+      if (!(is >> f))
+        throw std::invalid_argument("expected at least 4 FEN fields");
+      fen += (fen.empty() ? "" : " ") + f;
+    }
+
+    std::string rest;
+    std::getline(is, rest);
+    std::istringstream ops(rest);
+    std::string op;
+    Search::Limits epd;
+    bool hasLimits = false;
+    while (std::getline(ops, op, ';')) {
+      std::istringstream os(op);
+      std::string code, operand;
+      if (!(os >> code))
+        continue;
+      std::getline(os >> std::ws, operand);
+      if (code == "id") {
+        id = operand.size() >= 2 && operand.front() == '"' ? operand.substr(1, operand.size() - 2) : operand;
+      } else if (code == "acd") {
+        epd.depth    = std::atoi(operand.c_str());
+        hasLimits    = true;
+      } else if (code == "acn") {
+        epd.nodes    = std::strtoull(operand.c_str(), nullptr, 10);
+        hasLimits    = true;
+      } else if (code == "acs") {
+        epd.movetime = int64_t(std::atof(operand.c_str()) * 1000);
+        hasLimits    = true;
+      } else if (std::isdigit(uint8_t(code[0]))) {
+        // FEN halfmove clock and fullmove number: no operations follow
+        break;
+      }
+    }
+    if (hasLimits)
+      limits = epd;
+    return fen;
+  }
+
+  static std::string scoreJson(int score) {
+    if (score >=  Search::MATE_SCORE - Search::MAX_PLY)
+      return "{\"mate\":" + std::to_string((Search::MATE_SCORE - score + 1) / 2) + "}";
+    if (score <= -Search::MATE_SCORE + Search::MAX_PLY)
+      return "{\"mate\":" + std::to_string(-(Search::MATE_SCORE + score) / 2) + "}";
+    return "{\"cp\":" + std::to_string(score) + "}";
+  }
+
+  // One JSON object (without newline) for one input line
+  static std::string analyzeLine(const Job& job, Search::ThreadData& td, const Search::Limits& defaults,
+                                 uint64_t& nodes) {
+    std::ostringstream os;
+    os << "{\"line\":" << job.lineNo;
+    try {
+      Search::Limits limits = defaults;
+      std::string id;
+      std::string fen = parseLine(job.line, limits, id);
+      os << ",\"fen\":\"" << jsonEscape(fen) << "\"";
+      if (!id.empty())
+        os << ",\"id\":\"" << jsonEscape(id) << "\"";
+
+      Board board;
+      board.setFen(fen);
+      if (board.isKingInCheck(~board.sideToMove))
+        throw std::invalid_argument("side not to move is in check");
+
+      Search::Result r = Search::searchPosition(td, board, limits);
+      nodes += r.nodes;
+      os << ",\"bestmove\":" << (r.bestMove ? "\"" + Board::moveToString(r.bestMove) + "\"" : "null");
+      if (r.bestMove)
+        os << ",\"score\":" << scoreJson(r.score);
+      else
+        os << ",\"result\":\"" << (board.isKingInCheck(board.sideToMove) ? "checkmate" : "stalemate") << "\"";
+      os << ",\"depth\":" << r.depth << ",\"nodes\":" << r.nodes << ",\"time_ms\":" << r.timeMs;
+    } catch (const std::exception& e) {
+      os << ",\"error\":\"" << jsonEscape(e.what()) << "\"";
+    }
+    os << "}";
+    return os.str();
+  }
+
+  int run(int argc, char** argv) {
+    std::string inputPath = "-", outputPath;
+    int     threads = int(std::max(1u, std::thread::hardware_concurrency()));
+    size_t  hashMB  = 64;
+    Search::Limits defaults;
+    for (int i = 0; i < argc; ++i) {
+      std::string a = argv[i];
+      bool hasValue = i + 1 < argc;
+      if      (a == "--threads"  && hasValue) threads           = std::max(1, std::atoi(argv[++i]));
+      else if (a == "--depth"    && hasValue) defaults.depth    = std::atoi(argv[++i]);
+      else if (a == "--movetime" && hasValue) defaults.movetime = std::atoll(argv[++i]);
+      else if (a == "--nodes"    && hasValue) defaults.nodes    = std::strtoull(argv[++i], nullptr, 10);
+      else if (a == "--hash"     && hasValue) hashMB            = std::max(1, std::atoi(argv[++i]));
+      else if (a == "--output"   && hasValue) outputPath        = argv[++i];
+      else if (a.size() > 1 && a[0] == '-') {
+        std::cerr << "usage: chess-bot analyze [file|-] [--threads N] [--depth D] [--movetime MS]"
+                     " [--nodes N] [--hash MB] [--output FILE]\n";
+        return 2;
+      }
+      else inputPath = a;
+    }
+    if (!defaults.depth && !defaults.movetime && !defaults.nodes)
+      defaults.depth = DEFAULT_DEPTH;
+
+    std::ifstream inFile;
+    if (inputPath != "-") {
+      inFile.open(inputPath);
+      if (!inFile) { std::cerr << "analyze: cannot open " << inputPath << "\n"; return 1; }
+    }
+    std::ofstream outFile;
+    if (!outputPath.empty()) {
+      outFile.open(outputPath);
+      if (!outFile) { std::cerr << "analyze: cannot write " << outputPath << "\n"; return 1; }
+    }
+    std::istream& in  = inputPath == "-"  ? std::cin  : inFile;
+    std::ostream& out = outputPath.empty() ? std::cout : outFile;
+
+    TT.resize(hashMB);
+    BoundedQueue<Job> jobs(QUEUE_PER_WORKER * threads);
+    ReorderWindow     results(WINDOW_PER_WORKER * threads);
+    std::vector<uint64_t> workerNodes(threads, 0);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < threads; ++w) {
+      workers.emplace_back([&, w] {
+        auto td = std::make_unique<Search::ThreadData>();
+        Job job;
+        while (jobs.pop(job))
+          results.put(job.seq, analyzeLine(job, *td, defaults, workerNodes[w]));
+      });
+    }
+
+    std::thread writer([&] {
+      std::string line;
+      while (results.take(line))
+        out << line << '\n';
+      out.flush();
+    });
+
+    // Reader: this thread. Blank lines and '#' comments are skipped.
+    uint64_t seq = 0, lineNo = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+      ++lineNo;
+      size_t first = line.find_first_not_of(" \t\r");
+      if (first == std::string::npos || line[first] == '#')
+        continue;
+      jobs.push(Job{ seq++, lineNo, line });
+    }
+    jobs.close();
+    results.finish(seq);
+
+    for (auto& t : workers) t.join();
+    writer.join();
+
+    uint64_t nodes = 0;
+    for (uint64_t n : workerNodes) nodes += n;
+    int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start).count();
+    std::cerr << "analyzed " << seq << " positions with " << threads << " thread(s) in " << ms << " ms, "
+              << nodes << " nodes, " << nodes * 1000 / uint64_t(std::max<int64_t>(ms, 1)) << " nps\n";
+    return 0;
+  }
+}
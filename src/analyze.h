@@ -0,0 +1,10 @@
+#pragma once
+
+namespace Analyze {
+  // Command-line entry point for the "analyze" mode:
+  //   analyze [file|-] [--threads N] [--depth D] [--movetime MS] [--nodes N] [--hash MB] [--output FILE]
+  // Streams FEN/EPD lines (stdin by default) through a pool of search workers and writes one JSON
+  // object per position, in input order. EPD opcodes acd (depth), acn (nodes) and acs (seconds)
+  // override the command-line limits for their position. Returns the process exit code.
+  int run(int argc, char** argv);
+}
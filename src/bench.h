@@ -0,0 +1,10 @@
+#pragma once
+
+namespace Bench {
+  // Command-line entry point for the "bench" mode:
+  //   bench [depth] [threads] [hash MB]
+  // Searches a fixed suite of positions to the given depth and reports nodes, time and nodes/second.
+  // Every position starts from cleared tables, so with one thread the node total is a signature
+  // of the search: it changes exactly when search behaviour does. Returns the process exit code.
+  int run(int argc, char** argv);
+}
@@ -0,0 +1,219 @@
+#include "bitbase.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace Bitbases {
+
+  // Every table has the strong side as White. Slots are indexed by
+  //   stm + 2 * (weak king + 64 * (piece + 64 * strong king))        rook and queen
+  //   stm + 2 * (weak king + 64 * (strong king + 64 * pawn slot))    pawn
+  // Piece tables keep the strong king in the a1-d1-d4 triangle (10 squares) by symmetry; pawn
+  // tables keep the pawn on files a-d, ranks 2-7 (24 slots).
+  constexpr int TRIANGLE_SQUARES = 10;
+  constexpr int PAWN_SLOTS       = 24;
+  constexpr int PIECE_SIZE       = 2 * 64 * 64 * TRIANGLE_SQUARES;
+  constexpr int PAWN_SIZE        = 2 * 64 * 64 * PAWN_SLOTS;
+
+  // Working states of the solver; only WIN survives, as a set bit
+  enum State : uint8_t { INVALID, UNSOLVED, DRAWN, WON };
+
+  static std::vector<uint64_t> tables[6];   // by PieceType of the strong side's extra piece
+  static bool initialized = false;
+
+  static const std::array<int8_t, 64> TRIANGLE = [] {
+    std::array<int8_t, 64> t{};
+    int n = 0;
+    for (int sq = 0; sq < 64; ++sq)
+      t[sq] = (sq & 7) <= 3 && (sq >> 3) <= (sq & 7) ? int8_t(n++) : int8_t(-1);
+    return t;
+  }();
+  static const std::array<int8_t, TRIANGLE_SQUARES> TRIANGLE_SQUARE = [] {
+    std::array<int8_t, TRIANGLE_SQUARES> t{};
+    for (int sq = 0; sq < 64; ++sq)
+      if (TRIANGLE[sq] >= 0) t[TRIANGLE[sq]] = int8_t(sq);
+    return t;
+  }();
+
+  static int distance(int a, int b) {
+    return std::max(std::abs((a & 7) - (b & 7)), std::abs((a >> 3) - (b >> 3)));
+  }
+  static int transpose(int sq) { return ((sq & 7) << 3) | (sq >> 3); }
+
+  // Slot of a position with White as the strong side; squares may need mirroring first
+  static int pieceIndex(Color stm, int wk, int piece, int bk) {
+    if ((wk & 7) > 3)         { wk ^= 7;  piece ^= 7;  bk ^= 7;  }
+    if ((wk >> 3) > 3)        { wk ^= 56; piece ^= 56; bk ^= 56; }
+    if ((wk >> 3) > (wk & 7)) { wk = transpose(wk); piece = transpose(piece); bk = transpose(bk); }
+    return stm + 2 * (bk + 64 * (piece + 64 * TRIANGLE[wk]));
+  }
+  static int pawnIndex(Color stm, int wk, int pawn, int bk) {
+    if ((pawn & 7) > 3) { wk ^= 7; pawn ^= 7; bk ^= 7; }
+    return stm + 2 * (bk + 64 * (wk + 64 * ((pawn & 7) * 6 + (pawn >> 3) - 1)));
+  }
+
+  template <PieceType Strong>
+  static uint64_t strongAttacks(int sq, uint64_t occ) {
+    if constexpr (Strong == PAWN)  return Board::PAWN_ATTACKS_WHITE[sq];
+    if constexpr (Strong == ROOK)  return Board::rookAttacks(sq, occ);
+    if constexpr (Strong == QUEEN) return Board::queenAttacks(sq, occ);
+  }
+
+  template <PieceType Strong>
+  static void decode(int idx, Color& stm, int& wk, int& piece, int& bk) {
+    stm = Color(idx & 1);
+    bk  = (idx >> 1) & 63;
+    if constexpr (Strong == PAWN) {
+      wk = (idx >> 7) & 63;
+      int slot = idx >> 13;
+      piece = (slot / 6) + 8 * (slot % 6 + 1);
+    } else {
+      piece = (idx >> 7) & 63;
+      wk    = TRIANGLE_SQUARE[idx >> 13];
+    }
+  }
+
+  template <PieceType Strong>
+  static int indexOf(Color stm, int wk, int piece, int bk) {
+    if constexpr (Strong == PAWN) return pawnIndex(stm, wk, piece, bk);
+    else                          return pieceIndex(stm, wk, piece, bk);
+  }
+
+  // Weak king moves: off the strong king's and piece's attacks (sliders see through the moving king)
+  template <PieceType Strong>
+  static uint64_t weakKingMoves(int wk, int piece, int bk) {
+    uint64_t occ = 1ULL << wk;
+    return Board::KING_ATTACKS[bk] & ~Board::KING_ATTACKS[wk] & ~strongAttacks<Strong>(piece, occ) & ~(1ULL << piece);
+  }
+
+  // Positions decided without looking ahead: illegal ones, stalemates, mates, hanging pieces and
+  // safe promotions. Everything else starts unsolved.
+  template <PieceType Strong>
+  static State classify(Color stm, int wk, int piece, int bk) {
+    if (wk == bk || wk == piece || bk == piece || distance(wk, bk) <= 1)
+      return INVALID;
+    uint64_t occ     = (1ULL << wk) | (1ULL << bk);
+    bool     inCheck = strongAttacks<Strong>(piece, occ) & (1ULL << bk);
+    if (stm == WHITE) {
+      if (inCheck)
+        return INVALID;
+      if constexpr (Strong == PAWN) {
+        int promo = piece + 8;
+        if ((piece >> 3) == 6 && promo != wk && promo != bk
+            && (distance(bk, promo) > 1 || distance(wk, promo) == 1))
+          return WON;
+      }
+      return UNSOLVED;
+    }
+    if ((Board::KING_ATTACKS[bk] & (1ULL << piece)) && !(Board::KING_ATTACKS[wk] & (1ULL << piece)))
+      return DRAWN;                                     // the piece hangs
+    if (!weakKingMoves<Strong>(wk, piece, bk))
+      return inCheck ? WON : DRAWN;                     // mate or stalemate
+    return UNSOLVED;
+  }
+
+  // One sweep over the unsolved positions. The strong side wins if some move wins; the weak side
+  // draws if some move draws. Returns whether anything changed.
+  template <PieceType Strong>
+  static bool sweep(std::vector<State>& states) {
+    bool changed = false;
+    for (int idx = 0; idx < int(states.size()); ++idx) {
+      if (states[idx] != UNSOLVED)
+        continue;
+      Color stm; int wk, piece, bk;
+      decode<Strong>(idx, stm, wk, piece, bk);
+
+      bool anyWin = false, allDraw = true, anyDraw = false, allWin = true;
+      auto visit = [&](int next) {
+        State s = states[next];
+        anyWin  |= s == WON;    allDraw &= s == DRAWN;
+        anyDraw |= s == DRAWN;  allWin  &= s == WON;
+      };
+
+      if (stm == WHITE) {
+        uint64_t occ   = (1ULL << wk) | (1ULL << piece) | (1ULL << bk);
+        uint64_t kings = Board::KING_ATTACKS[wk] & ~Board::KING_ATTACKS[bk] & ~(1ULL << piece);
+        for (uint64_t b = kings; b; b &= b - 1)
+          visit(indexOf<Strong>(BLACK, __builtin_ctzll(b), piece, bk));
+        if constexpr (Strong == PAWN) {
+          int push = piece + 8;                             // promotions were classified already
+          if ((push >> 3) < 7 && !(occ & (1ULL << push))) {
+            visit(indexOf<Strong>(BLACK, wk, push, bk));
+            if ((piece >> 3) == 1 && !(occ & (1ULL << (push + 8))))
+              visit(indexOf<Strong>(BLACK, wk, push + 8, bk));
+          }
+        } else {
+          for (uint64_t b = strongAttacks<Strong>(piece, occ) & ~occ; b; b &= b - 1)
+            visit(indexOf<Strong>(BLACK, wk, __builtin_ctzll(b), bk));
+        }
+        if (anyWin || allDraw) {
+          states[idx] = anyWin ? WON : DRAWN;
+          changed     = true;
+        }
+      } else {
+        for (uint64_t b = weakKingMoves<Strong>(wk, piece, bk); b; b &= b - 1)
+          visit(indexOf<Strong>(WHITE, wk, piece, __builtin_ctzll(b)));
+        if (anyDraw || allWin) {
+          states[idx] = anyDraw ? DRAWN : WON;
+          changed     = true;
+        }
+      }
+    }
+    return changed;
+  }
+
+  // Positions never resolved are ones the strong side cannot force home: draws
+  template <PieceType Strong>
+  static void solve() {
+    std::vector<State> states(Strong == PAWN ? PAWN_SIZE : PIECE_SIZE);
+    for (int idx = 0; idx < int(states.size()); ++idx) {
+      Color stm; int wk, piece, bk;
+      decode<Strong>(idx, stm, wk, piece, bk);
+      states[idx] = classify<Strong>(stm, wk, piece, bk);
+    }
+    while (sweep<Strong>(states)) {}
+
+    std::vector<uint64_t>& bits = tables[Strong];
+    bits.assign(states.size() / 64, 0);
+    for (size_t idx = 0; idx < states.size(); ++idx)
+      if (states[idx] == WON)
+        bits[idx / 64] |= 1ULL << (idx % 64);
+  }
+
+  void init() {
+    if (initialized)
+      return;
+    solve<PAWN>();
+    solve<ROOK>();
+    solve<QUEEN>();
+    initialized = true;
+  }
+
+  Outcome probe(const Board& board) {
+    int pieces = __builtin_popcountll(board.allPieces);
+    if (pieces == 2)
+      return DRAW;
+    if (pieces != 3 || !initialized)
+      return UNKNOWN;
+
+    Color strong = __builtin_popcountll(board.occupancy[WHITE]) == 2 ? WHITE : BLACK;
+    uint64_t extra = board.occupancy[strong] & ~board.pieces[strong][KING];
+    PieceType pt   = typeOf(board.pieceOn(__builtin_ctzll(extra)));
+    if (pt == KNIGHT || pt == BISHOP)
+      return DRAW;
+
+    // Tables have the strong side as White: flip the board vertically for Black
+    int flip  = strong == WHITE ? 0 : 56;
+    int wk    = __builtin_ctzll(board.pieces[strong][KING]) ^ flip;
+    int bk    = __builtin_ctzll(board.pieces[~strong][KING]) ^ flip;
+    int piece = __builtin_ctzll(extra) ^ flip;
+    Color stm = board.sideToMove == strong ? WHITE : BLACK;
+
+    int idx = pt == PAWN ? pawnIndex(stm, wk, piece, bk) : pieceIndex(stm, wk, piece, bk);
+    if (!(tables[pt][idx / 64] >> (idx % 64) & 1))
+      return DRAW;
+    return stm == WHITE ? WIN : LOSS;
+  }
+}
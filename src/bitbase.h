@@ -0,0 +1,18 @@
+#pragma once
+#include "board.h"
+
+// Win/draw bitbases for king and pawn, rook or queen against a lone king, solved by retrograde
+// analysis when the program starts (a few hundred KB of work, 1 bit per position kept).
+// Bare kings and a lone minor piece are known draws without a table.
+namespace Bitbases {
+
+  constexpr int MAX_PIECES = 3;   // kings included
+
+  // Result for the side to move; UNKNOWN when no bitbase covers the position
+  enum Outcome { UNKNOWN, DRAW, WIN, LOSS };
+
+  // Solve all tables; probe() answers UNKNOWN until this has run
+  void init();
+
+  Outcome probe(const Board& board);
+}
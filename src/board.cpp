@@ -1,106 +1,309 @@
 // Optimized move generation and check detection for Board
 #include "board.h"
+#include "eval.h"
+#include "nnue.h"
+#include <algorithm>
 #include <array>
-#include <vector>
-#include <utility>
 #include <iostream>
 #include <stdexcept>
-#include <cmath>
-
-// Initialize precomputed attack tables
-const std::array<uint64_t,64> Board::KNIGHT_ATTACKS = [](){
-    std::array<uint64_t,64> tbl{};
-    for(int sq=0; sq<64; ++sq){
-        int f = sq % 8, r = sq / 8;
-        uint64_t m = 0;
-        const int offs[8][2] = {{1,2},{2,1},{2,-1},{1,-2},{-1,-2},{-2,-1},{-2,1},{-1,2}};
-        for(auto &o: offs){
-            int nf = f + o[0], nr = r + o[1];
-            if(nf>=0 && nf<8 && nr>=0 && nr<8)
-                m |= 1ULL << (nr*8 + nf);
+#include <sstream>
+
+// Magic multipliers for the slider tables (found offline with a sparse random search, one per square)
+static constexpr uint64_t ROOK_MAGIC_NUMBERS[64] = {
+    0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+    0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+    0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+    0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+    0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+    0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+    0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+    0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+    0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+    0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+    0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+    0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+    0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+    0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+    0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+    0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+};
+static constexpr uint64_t BISHOP_MAGIC_NUMBERS[64] = {
+    0xA010041108003100ULL, 0x006082020A002900ULL, 0x6810010619200000ULL, 0x08281A0520000408ULL,
+    0x0001104001000400ULL, 0x0018901008048400ULL, 0x00040A0210245280ULL, 0x000200210808A402ULL,
+    0x9140048410821200ULL, 0x0800091010820041ULL, 0x20504804832202C0ULL, 0x0100091401081000ULL,
+    0x8021011140000012ULL, 0x0810020804450400ULL, 0x208B0542109008A2ULL, 0x0080084A08040204ULL,
+    0x0040E2A80811244CULL, 0x2505022008008108ULL, 0x0430220100420040ULL, 0x010A040420220040ULL,
+    0x1105000290400000ULL, 0x0093001200822120ULL, 0x4000A62048043004ULL, 0x280120048A015004ULL,
+    0x006090002A020814ULL, 0x44042000240800D0ULL, 0x01102800040A4400ULL, 0x1004080080220040ULL,
+    0x0001001011004024ULL, 0x0010044000805040ULL, 0x0914041200820100ULL, 0x0004821012821480ULL,
+    0x0024040500C05021ULL, 0x0088611002080200ULL, 0x0116080A00040020ULL, 0x4000020080080080ULL,
+    0x2450450140840040ULL, 0x0000880201484100ULL, 0x0222020404020092ULL, 0x8081110600002E00ULL,
+    0x2842101105000801ULL, 0x1100809008001025ULL, 0x00020202221C0400ULL, 0x0422014022009020ULL,
+    0x0210046102100C00ULL, 0xC004008082029102ULL, 0x00AA461801101200ULL, 0x0404080080201108ULL,
+    0x020542108C205002ULL, 0x0410544804100100ULL, 0x0040910841100000ULL, 0x0400200042021100ULL,
+    0x00004204850400C0ULL, 0x0200100410A42102ULL, 0x1040020801210102ULL, 0x0805040410420000ULL,
+    0x2884804130100200ULL, 0x800C262201242000ULL, 0x1058000194108800ULL, 0x0014221054420204ULL,
+    0x0104000012A02200ULL, 0x0200881003300100ULL, 0x0140400202840100ULL, 0x0402020801010201ULL
+};
+
+// Slow ray walk, only used to fill the slider tables
+static constexpr uint64_t slidingAttacks(int sq, uint64_t occ, const int (&dirs)[4][2]) {
+    uint64_t m = 0;
+    for (auto &d : dirs) {
+        int f = sq % 8 + d[0], r = sq / 8 + d[1];
+        while (f>=0 && f<8 && r>=0 && r<8) {
+            m |= 1ULL << (r*8 + f);
+            if (occ & (1ULL << (r*8 + f))) break;
+            f += d[0]; r += d[1];
         }
-        tbl[sq] = m;
+    }
+    return m;
+}
+static constexpr int ROOK_DIRS[4][2]   = {{1,0},{-1,0},{0,1},{0,-1}};
+static constexpr int BISHOP_DIRS[4][2] = {{1,1},{1,-1},{-1,1},{-1,-1}};
+
+// Relevant-occupancy masks exclude the last square of each ray: a blocker there never changes the result
+static constexpr std::array<Board::Magic,64> buildMagics(const int (&dirs)[4][2], const uint64_t (&numbers)[64], uint32_t base) {
+    std::array<Board::Magic,64> tbl{};
+    uint32_t offset = base;
+    for (int sq=0; sq<64; ++sq) {
+        uint64_t edges = ((0x00000000000000FFULL | 0xFF00000000000000ULL) & ~(0xFFULL << (sq/8*8)))
+                       | ((0x0101010101010101ULL | 0x8080808080808080ULL) & ~(0x0101010101010101ULL << (sq%8)));
+        Board::Magic &m = tbl[sq];
+        m.mask   = slidingAttacks(sq, 0, dirs) & ~edges;
+        m.magic  = numbers[sq];
+        m.shift  = 64 - __builtin_popcountll(m.mask);
+        m.offset = offset;
+        offset  += 1u << __builtin_popcountll(m.mask);
     }
     return tbl;
-}();
-const std::array<uint64_t,64> Board::KING_ATTACKS = [](){
-    std::array<uint64_t,64> tbl{};
-    for(int sq=0; sq<64; ++sq){
-        int f = sq % 8, r = sq / 8;
-        uint64_t m = 0;
-        for(int df=-1; df<=1; ++df) for(int dr=-1; dr<=1; ++dr){
-            if(df||dr){
-                int nf=f+df, nr=r+dr;
-                if(nf>=0 && nf<8 && nr>=0 && nr<8)
-                    m |= 1ULL << (nr*8 + nf);
-            }
-        }
-        tbl[sq] = m;
+}
+static constexpr std::array<Board::Magic,64> ROOK_MAGIC_TABLE   = buildMagics(ROOK_DIRS,   ROOK_MAGIC_NUMBERS,   0);
+static constexpr std::array<Board::Magic,64> BISHOP_MAGIC_TABLE = buildMagics(BISHOP_DIRS, BISHOP_MAGIC_NUMBERS, 102400);
+constinit const std::array<Board::Magic,64> Board::ROOK_MAGICS   = ROOK_MAGIC_TABLE;
+constinit const std::array<Board::Magic,64> Board::BISHOP_MAGICS = BISHOP_MAGIC_TABLE;
+
+// Enumerate every subset of each mask (carry-rippler) and store the ray attacks at its index
+const std::array<uint64_t,Board::SLIDER_TABLE_SIZE> Board::SLIDER_ATTACKS = [](){
+    std::array<uint64_t,SLIDER_TABLE_SIZE> tbl{};
+    for (int sq=0; sq<64; ++sq) {
+        const Magic &rook = ROOK_MAGIC_TABLE[sq], &bishop = BISHOP_MAGIC_TABLE[sq];
+        uint64_t occ = 0;
+        do {
+            tbl[rook.index(occ)] = slidingAttacks(sq, occ, ROOK_DIRS);
+            occ = (occ - rook.mask) & rook.mask;
+        } while (occ);
+        do {
+            tbl[bishop.index(occ)] = slidingAttacks(sq, occ, BISHOP_DIRS);
+            occ = (occ - bishop.mask) & bishop.mask;
+        } while (occ);
     }
     return tbl;
 }();
-const std::array<uint64_t,64> Board::PAWN_ATTACKS_WHITE = [](){
-    std::array<uint64_t,64> tbl{};
-    for(int sq=0; sq<64; ++sq){
-        int f=sq%8, r=sq/8; uint64_t m=0;
-        if(r<7){
-            if(f>0)   m |= 1ULL<<((r+1)*8 + (f-1));
-            if(f<7)   m |= 1ULL<<((r+1)*8 + (f+1));
-        }
-        tbl[sq]=m;
+
+// Between/line tables for pin and check-evasion masks
+constinit const std::array<std::array<uint64_t,64>,64> Board::BETWEEN = [](){
+    std::array<std::array<uint64_t,64>,64> tbl{};
+    for (int a=0; a<64; ++a) for (int b=0; b<64; ++b) {
+        uint64_t bbA = 1ULL << a, bbB = 1ULL << b;
+        if (a != b && (slidingAttacks(a, 0, ROOK_DIRS) & bbB))
+            tbl[a][b] = slidingAttacks(a, bbB, ROOK_DIRS) & slidingAttacks(b, bbA, ROOK_DIRS);
+        else if (a != b && (slidingAttacks(a, 0, BISHOP_DIRS) & bbB))
+            tbl[a][b] = slidingAttacks(a, bbB, BISHOP_DIRS) & slidingAttacks(b, bbA, BISHOP_DIRS);
     }
     return tbl;
 }();
-const std::array<uint64_t,64> Board::PAWN_ATTACKS_BLACK = [](){
-    std::array<uint64_t,64> tbl{};
-    for(int sq=0; sq<64; ++sq){
-        int f=sq%8, r=sq/8; uint64_t m=0;
-        if(r>0){
-            if(f>0)   m |= 1ULL<<((r-1)*8 + (f-1));
-            if(f<7)   m |= 1ULL<<((r-1)*8 + (f+1));
-        }
-        tbl[sq]=m;
+constinit const std::array<std::array<uint64_t,64>,64> Board::LINE = [](){
+    std::array<std::array<uint64_t,64>,64> tbl{};
+    for (int a=0; a<64; ++a) for (int b=0; b<64; ++b) {
+        uint64_t ends = (1ULL << a) | (1ULL << b);
+        if (a != b && (slidingAttacks(a, 0, ROOK_DIRS) & (1ULL << b)))
+            tbl[a][b] = (slidingAttacks(a, 0, ROOK_DIRS) & slidingAttacks(b, 0, ROOK_DIRS)) | ends;
+        else if (a != b && (slidingAttacks(a, 0, BISHOP_DIRS) & (1ULL << b)))
+            tbl[a][b] = (slidingAttacks(a, 0, BISHOP_DIRS) & slidingAttacks(b, 0, BISHOP_DIRS)) | ends;
     }
     return tbl;
 }();
 
+// Castling rights that survive a move touching each square (king and rook home squares clear theirs)
+static constexpr std::array<uint8_t,64> CASTLING_MASK = [](){
+    std::array<uint8_t,64> tbl{};
+    for (auto &m : tbl) m = 0xF;
+    tbl[0]  = uint8_t(~Board::WHITE_OOO);
+    tbl[4]  = uint8_t(~(Board::WHITE_OO | Board::WHITE_OOO));
+    tbl[7]  = uint8_t(~Board::WHITE_OO);
+    tbl[56] = uint8_t(~Board::BLACK_OOO);
+    tbl[60] = uint8_t(~(Board::BLACK_OO | Board::BLACK_OOO));
+    tbl[63] = uint8_t(~Board::BLACK_OO);
+    return tbl;
+}();
+
+// Zobrist keys, drawn from a fixed-seed splitmix64 stream so hashes are reproducible between runs
+struct ZobristKeys {
+    uint64_t piece[12][64];     // indexed by Piece
+    uint64_t castling[16];
+    uint64_t epFile[8];
+    uint64_t side;              // xored in when black is to move
+};
+static const ZobristKeys ZOBRIST = [](){
+    ZobristKeys z{};
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    auto next = [&seed]() {
+        uint64_t x = (seed += 0x9E3779B97F4A7C15ULL);
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    };
+    for (auto &pc : z.piece) for (auto &k : pc) k = next();
+    for (auto &k : z.castling) k = next();
+    for (auto &k : z.epFile)   k = next();
+    z.side = next();
+    return z;
+}();
+
+// Display characters, indexed by Piece (NO_PIECE prints as '.')
+static constexpr const char* PIECE_CHARS = "PNBRQKpnbrqk.";
+
+// Material and PST contribution of a piece on a square, signed from white's point of view
+static inline int materialOf(Piece p) {
+    return colorOf(p) == WHITE ? Eval::PieceValue[typeOf(p)] : -Eval::PieceValue[typeOf(p)];
+}
+static inline int psqtOf(Piece p, int sq) {
+    return colorOf(p) == WHITE ? Eval::PST[typeOf(p)][sq] : -Eval::PST[typeOf(p)][sq ^ 56];
+}
+
+// Promotion piece type encoded in the low flag bits (knight, bishop, rook, queen)
+static inline PieceType promotionType(Move m) {
+    return PieceType(KNIGHT + (m.flags() & 3));
+}
+
 // Constructor initializes the board with standard starting positions
 Board::Board() {
-    whitePawns   = 0x000000000000FF00ULL;
-    whiteKnights = 0x0000000000000042ULL;
-    whiteBishops = 0x0000000000000024ULL;
-    whiteRooks   = 0x0000000000000081ULL;
-    whiteQueens  = 0x0000000000000008ULL;
-    whiteKing    = 0x0000000000000010ULL;
-
-    blackPawns   = 0x00FF000000000000ULL;
-    blackKnights = 0x4200000000000000ULL;
-    blackBishops = 0x2400000000000000ULL;
-    blackRooks   = 0x8100000000000000ULL;
-    blackQueens  = 0x0800000000000000ULL;
-    blackKing    = 0x1000000000000000ULL;
-    sideToMove   = WHITE;
-}
-
-// Helpers to get all pieces for white, black, or both
-uint64_t Board::getWhitePieces() const {
-    return whitePawns
-         | whiteKnights
-         | whiteBishops
-         | whiteRooks
-         | whiteQueens
-         | whiteKing;
-}
-uint64_t Board::getBlackPieces() const {
-    return blackPawns
-         | blackKnights
-         | blackBishops
-         | blackRooks
-         | blackQueens
-         | blackKing;
-}
-uint64_t Board::getAllPieces() const {
-    return getWhitePieces() | getBlackPieces();
+    setFen(START_FEN);
+}
+
+void Board::setFen(const std::string& fen) {
+    std::istringstream in(fen);
+    std::string placement, side, castling = "-", ep = "-";
+    if (!(in >> placement >> side)) {
+        throw std::invalid_argument("setFen: expected piece placement and side to move");
+    }
+    in >> castling >> ep;
+
+    Board b = *this;
+    for (auto &c : b.pieces) for (auto &bb : c) bb = 0;
+    b.occupancy[WHITE] = b.occupancy[BLACK] = b.allPieces = 0;
+    for (auto &p : b.mailbox) p = NO_PIECE;
+
+    // Eight ranks of exactly eight files each
+    int rank = 7, file = 0;
+    for (char c : placement) {
+        if (c == '/') {
+            if (file != 8 || rank == 0) {
+                throw std::invalid_argument("setFen: bad piece placement '" + placement + "'");
+            }
+            --rank; file = 0;
+        } else if (c >= '1' && c <= '8' && file + (c - '0') <= 8) {
+            file += c - '0';
+        } else {
+            const char* pc = std::char_traits<char>::find(PIECE_CHARS, 12, c);
+            if (!pc || file > 7) {
+                throw std::invalid_argument("setFen: bad piece placement '" + placement + "'");
+            }
+            b.addPiece(Piece(pc - PIECE_CHARS), rank * 8 + file++);
+        }
+    }
+    if (rank != 0 || file != 8) {
+        throw std::invalid_argument("setFen: bad piece placement '" + placement + "'");
+    }
+    if (__builtin_popcountll(b.pieces[WHITE][KING]) != 1 || __builtin_popcountll(b.pieces[BLACK][KING]) != 1) {
+        throw std::invalid_argument("setFen: each side needs exactly one king");
+    }
+    if ((b.pieces[WHITE][PAWN] | b.pieces[BLACK][PAWN]) & 0xFF000000000000FFULL) {
+        throw std::invalid_argument("setFen: pawn on the first or eighth rank");
+    }
+
+    if (side != "w" && side != "b") {
+        throw std::invalid_argument("setFen: side to move must be 'w' or 'b'");
+    }
+    b.sideToMove = side == "w" ? WHITE : BLACK;
+    if (b.isKingInCheck(~b.sideToMove)) {
+        throw std::invalid_argument("setFen: the side not to move is in check");
+    }
+
+    b.castlingRights = 0;
+    for (char c : castling) {
+        switch (c) {
+            case 'K': b.castlingRights |= WHITE_OO;  break;
+            case 'Q': b.castlingRights |= WHITE_OOO; break;
+            case 'k': b.castlingRights |= BLACK_OO;  break;
+            case 'q': b.castlingRights |= BLACK_OOO; break;
+            case '-': break;
+            default: throw std::invalid_argument("setFen: bad castling field '" + castling + "'");
+        }
+    }
+    // A right only stands while its king and rook are on their home squares
+    auto home = [&](Color c, PieceType pt, int sq) { return (b.pieces[c][pt] >> sq) & 1; };
+    if (!home(WHITE, KING, 4))  b.castlingRights &= ~(WHITE_OO | WHITE_OOO);
+    if (!home(WHITE, ROOK, 7))  b.castlingRights &= ~WHITE_OO;
+    if (!home(WHITE, ROOK, 0))  b.castlingRights &= ~WHITE_OOO;
+    if (!home(BLACK, KING, 60)) b.castlingRights &= ~(BLACK_OO | BLACK_OOO);
+    if (!home(BLACK, ROOK, 63)) b.castlingRights &= ~BLACK_OO;
+    if (!home(BLACK, ROOK, 56)) b.castlingRights &= ~BLACK_OOO;
+
+    // Same rule as makeMove: keep the en passant square only if a pawn can capture on it
+    b.epSquare = -1;
+    if (ep != "-") {
+        // The square a pawn of the side not to move just skipped: empty, as is the square the
+        // pawn started from, with the pawn on the square in front
+        Color them = ~b.sideToMove;
+        if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || ep[1] != (b.sideToMove == WHITE ? '6' : '3')) {
+            throw std::invalid_argument("setFen: bad en passant square '" + ep + "'");
+        }
+        int sq    = b.squareIndex(ep);
+        int pawn  = b.sideToMove == WHITE ? sq - 8 : sq + 8;
+        int start = b.sideToMove == WHITE ? sq + 8 : sq - 8;
+        if (b.mailbox[sq] != NO_PIECE || b.mailbox[start] != NO_PIECE || b.mailbox[pawn] != makePiece(them, PAWN)) {
+            throw std::invalid_argument("setFen: no pawn just passed en passant square '" + ep + "'");
+        }
+        if (b.sideToMove == WHITE ? (PAWN_ATTACKS_BLACK[sq] & b.pieces[WHITE][PAWN])
+                                  : (PAWN_ATTACKS_WHITE[sq] & b.pieces[BLACK][PAWN]))
+            b.epSquare = sq;
+    }
+
+    b.hashKey  = b.computeHash();
+    b.pawnKey  = b.computePawnKey();
+    b.material = Eval::materialScore(b);
+    b.psqt     = Eval::positionScore(b);
+    *this = b;
+}
+
+void Board::attachNnue(NNUE::AccumulatorStack* stack) {
+    nnue.stack = stack;
+    if (stack) stack->reset(*this);
+}
+
+uint64_t Board::computeHash() const {
+    uint64_t h = 0;
+    for (int sq = 0; sq < 64; ++sq)
+        if (mailbox[sq] != NO_PIECE) h ^= ZOBRIST.piece[mailbox[sq]][sq];
+    h ^= ZOBRIST.castling[castlingRights];
+    if (epSquare >= 0)        h ^= ZOBRIST.epFile[epSquare & 7];
+    if (sideToMove == BLACK)  h ^= ZOBRIST.side;
+    return h;
+}
+
+uint64_t Board::computePawnKey() const {
+    uint64_t h = 0;
+    for (Color c : { WHITE, BLACK }) {
+        Piece    pawn = makePiece(c, PAWN);
+        uint64_t bb   = pieces[c][PAWN];
+        while (bb) {
+            h  ^= ZOBRIST.piece[pawn][__builtin_ctzll(bb)];
+            bb &= bb - 1;
+        }
+    }
+    return h;
 }
 
 // Print the board in a human-readable format
@@ -117,97 +320,185 @@ void Board::print() const {
     std::cout << "  a b c d e f g h\n\n";
 }
 char Board::getPieceAtSquare(int sq) const {
-    uint64_t mask = 1ULL << sq;
-    if (whitePawns   & mask) return 'P';
-    if (whiteKnights & mask) return 'N';
-    if (whiteBishops & mask) return 'B';
-    if (whiteRooks   & mask) return 'R';
-    if (whiteQueens  & mask) return 'Q';
-    if (whiteKing    & mask) return 'K';
-
-    if (blackPawns   & mask) return 'p';
-    if (blackKnights & mask) return 'n';
-    if (blackBishops & mask) return 'b';
-    if (blackRooks   & mask) return 'r';
-    if (blackQueens  & mask) return 'q';
-    if (blackKing    & mask) return 'k';
+    return PIECE_CHARS[mailbox[sq]];
+}
 
-    return '.';
+// Placement primitives
+inline void Board::addPiece(Piece p, int sq) {
+    uint64_t b = 1ULL << sq;
+    pieces[colorOf(p)][typeOf(p)] |= b;
+    occupancy[colorOf(p)]         |= b;
+    allPieces                     |= b;
+    mailbox[sq] = p;
+}
+inline void Board::removePiece(int sq) {
+    Piece    p = mailbox[sq];
+    uint64_t b = 1ULL << sq;
+    pieces[colorOf(p)][typeOf(p)] &= ~b;
+    occupancy[colorOf(p)]         &= ~b;
+    allPieces                     &= ~b;
+    mailbox[sq] = NO_PIECE;
 }
+inline void Board::shiftPiece(int from, int to) {
+    Piece    p = mailbox[from];
+    uint64_t b = (1ULL << from) | (1ULL << to);
+    pieces[colorOf(p)][typeOf(p)] ^= b;
+    occupancy[colorOf(p)]         ^= b;
+    allPieces                     ^= b;
+    mailbox[to]   = p;
+    mailbox[from] = NO_PIECE;
+}
+
+// Apply a legal move without validation (search fast path)
+template<Color Us>
+Board::MoveRecord Board::makeMove(Move m) {
+    constexpr Color Them = ~Us;
+    int   from  = m.from(), to = m.to(), flags = m.flags();
+    Piece moved = mailbox[from];
 
-Board::MoveRecord Board::makeMove(int from, int to) {
-    // 1) Verify there's a piece of the right color on 'from'
-    char pc = getPieceAtSquare(from);
-    bool movingWhite = (sideToMove == WHITE);
-    if (pc == '.' ||
-        (movingWhite  && !(pc >= 'A' && pc <= 'Z')) ||
-        (!movingWhite && !(pc >= 'a' && pc <= 'z'))) {
-        throw std::invalid_argument("makeMove: no piece of the correct color at source");
+    MoveRecord rec;
+    rec.move          = m;
+    rec.captured      = mailbox[to];
+    rec.prevCastling  = castlingRights;
+    rec.prevEpSquare  = epSquare;
+    rec.prevHash      = hashKey;
+    rec.prevPawnKey   = pawnKey;
+    rec.prevMaterial  = material;
+    rec.prevPsqt      = psqt;
+
+    // Hash out the old side, castling rights and en passant file
+    uint64_t h = hashKey ^ ZOBRIST.side ^ ZOBRIST.castling[castlingRights];
+    if (epSquare >= 0) h ^= ZOBRIST.epFile[epSquare & 7];
+
+    // Remove any captured piece (en passant takes the pawn behind the target square)
+    if (flags == EN_PASSANT || rec.captured != NO_PIECE) {
+        int capSq = flags == EN_PASSANT ? to ^ 8 : to;
+        rec.captured = mailbox[capSq];
+        removePiece(capSq);
+        h        ^= ZOBRIST.piece[rec.captured][capSq];
+        if (rec.captured == makePiece(Them, PAWN)) pawnKey ^= ZOBRIST.piece[rec.captured][capSq];
+        material -= materialOf(rec.captured);
+        psqt     -= psqtOf(rec.captured, capSq);
     }
 
-    // 2) Verify target is in pseudo-legal moves
-    auto pseudos = generatePseudoLegalMovesForSquare(from);
-    bool found = false;
-    for (int tgt : pseudos) {
-        if (tgt == to) { found = true; break; }
+    // Move the piece, swapping in the new piece on promotion
+    if (m.isPromotion()) {
+        Piece promo = makePiece(Us, promotionType(m));
+        removePiece(from);
+        addPiece(promo, to);
+        h        ^= ZOBRIST.piece[moved][from] ^ ZOBRIST.piece[promo][to];
+        pawnKey  ^= ZOBRIST.piece[moved][from];
+        material += materialOf(promo) - materialOf(moved);
+        psqt     += psqtOf(promo, to) - psqtOf(moved, from);
+    } else {
+        shiftPiece(from, to);
+        h        ^= ZOBRIST.piece[moved][from] ^ ZOBRIST.piece[moved][to];
+        if (moved == makePiece(Us, PAWN)) pawnKey ^= ZOBRIST.piece[moved][from] ^ ZOBRIST.piece[moved][to];
+        psqt     += psqtOf(moved, to) - psqtOf(moved, from);
     }
-    if (!found) {
-        throw std::invalid_argument("makeMove: target not in pseudo-legal moves");
+
+    // Castling also moves the rook
+    if (flags == KING_CASTLE || flags == QUEEN_CASTLE) {
+        int   rookFrom = flags == KING_CASTLE ? to + 1 : to - 2;
+        int   rookTo   = flags == KING_CASTLE ? to - 1 : to + 1;
+        constexpr Piece rook = makePiece(Us, ROOK);
+        shiftPiece(rookFrom, rookTo);
+        h    ^= ZOBRIST.piece[rook][rookFrom] ^ ZOBRIST.piece[rook][rookTo];
+        psqt += psqtOf(rook, rookTo) - psqtOf(rook, rookFrom);
     }
 
-    // 3) Build the MoveRecord and stash sideToMove BEFORE doing anything that might undo
-    MoveRecord rec;
-    rec.from          = from;
-    rec.to            = to;
-    rec.fromMask      = 1ULL << from;
-    rec.toMask        = 1ULL << to;
-    rec.movedPiece    = pc;
-    rec.capturedPiece = getPieceAtSquare(to);
-    rec.prevSide      = sideToMove;    // ← record who’s moving now
-
-    // 4) Remove any captured piece
-    whitePawns   &= ~rec.toMask;
-    whiteKnights &= ~rec.toMask;
-    whiteBishops &= ~rec.toMask;
-    whiteRooks   &= ~rec.toMask;
-    whiteQueens  &= ~rec.toMask;
-    whiteKing    &= ~rec.toMask;
-    blackPawns   &= ~rec.toMask;
-    blackKnights &= ~rec.toMask;
-    blackBishops &= ~rec.toMask;
-    blackRooks   &= ~rec.toMask;
-    blackQueens  &= ~rec.toMask;
-    blackKing    &= ~rec.toMask;
-
-    // 5) Move the piece’s bitboard
-    uint64_t &bb = pieceBitboard(rec.movedPiece);
-    bb &= ~rec.fromMask;
-    bb |= rec.toMask;
-
-    // 6) Legality check: does this leave the mover’s king in check?
-    if (isKingInCheck(rec.prevSide)) {
-        // undo and bail
-        unmakeMove(rec);
-        throw std::invalid_argument("makeMove: move would leave king in check");
-    }
-
-    // 7) All good → flip sideToMove and return record
-    sideToMove = (sideToMove == WHITE ? BLACK : WHITE);
+    // Only record an en passant square that an enemy pawn can actually capture on,
+    // so transpositions that differ just by a dead double push share a key
+    epSquare = -1;
+    if (flags == DOUBLE_PUSH) {
+        int ep = (from + to) / 2;
+        if (pawnAttacks<Us>()[ep] & pieces[Them][PAWN]) {
+            epSquare = ep;
+            h ^= ZOBRIST.epFile[ep & 7];
+        }
+    }
+    castlingRights &= CASTLING_MASK[from] & CASTLING_MASK[to];
+    h ^= ZOBRIST.castling[castlingRights];
+
+    hashKey    = h;
+    sideToMove = Them;
+    if (nnue.stack) nnue.stack->push(*this, rec);
     return rec;
 }
 
+Board::MoveRecord Board::makeMove(Move m) {
+    return sideToMove == WHITE ? makeMove<WHITE>(m) : makeMove<BLACK>(m);
+}
+
 // Undo a previously made move using the record (Needed for backtracking)
+template<Color Us>
 void Board::unmakeMove(const MoveRecord &rec) {
-    uint64_t &bb = pieceBitboard(rec.movedPiece);
-    bb &= ~rec.toMask;
-    bb |= rec.fromMask;
+    if (nnue.stack) nnue.stack->pop();
+    sideToMove     = Us;
+    castlingRights = rec.prevCastling;
+    epSquare       = rec.prevEpSquare;
+    hashKey        = rec.prevHash;
+    pawnKey        = rec.prevPawnKey;
+    material       = rec.prevMaterial;
+    psqt           = rec.prevPsqt;
+
+    Move m = rec.move;
+    int  from = m.from(), to = m.to(), flags = m.flags();
+    if (m.isPromotion()) {
+        removePiece(to);
+        addPiece(makePiece(Us, PAWN), from);
+    } else {
+        shiftPiece(to, from);
+    }
 
-    if (rec.capturedPiece != '.') {
-        uint64_t &cb = pieceBitboard(rec.capturedPiece);
-        cb |= rec.toMask;
+    if (flags == EN_PASSANT)
+        addPiece(rec.captured, to ^ 8);
+    else if (rec.captured != NO_PIECE)
+        addPiece(rec.captured, to);
+
+    if (flags == KING_CASTLE || flags == QUEEN_CASTLE) {
+        int rookFrom = flags == KING_CASTLE ? to + 1 : to - 2;
+        int rookTo   = flags == KING_CASTLE ? to - 1 : to + 1;
+        shiftPiece(rookTo, rookFrom);
     }
-    
-    sideToMove = rec.prevSide;
+}
+
+// The side that made the move is the one not to move now
+void Board::unmakeMove(const MoveRecord &rec) {
+    if (sideToMove == BLACK) unmakeMove<WHITE>(rec);
+    else                     unmakeMove<BLACK>(rec);
+}
+
+// Pass the turn: only the side to move and the en passant square change
+Board::MoveRecord Board::makeNullMove() {
+    MoveRecord rec;
+    rec.move          = Move();
+    rec.captured      = NO_PIECE;
+    rec.prevCastling  = castlingRights;
+    rec.prevEpSquare  = epSquare;
+    rec.prevHash      = hashKey;
+    rec.prevPawnKey   = pawnKey;
+    rec.prevMaterial  = material;
+    rec.prevPsqt      = psqt;
+
+    hashKey ^= ZOBRIST.side;
+    if (epSquare >= 0) hashKey ^= ZOBRIST.epFile[epSquare & 7];
+    epSquare   = -1;
+    sideToMove = ~sideToMove;
+    return rec;
+}
+
+void Board::unmakeNullMove(const MoveRecord& rec) {
+    sideToMove = ~sideToMove;
+    epSquare   = rec.prevEpSquare;
+    hashKey    = rec.prevHash;
+}
+
+int Board::nonPawnMaterial(Color c) const {
+    int v = 0;
+    for (int pt = KNIGHT; pt <= QUEEN; ++pt)
+        v += __builtin_popcountll(pieces[c][pt]) * Eval::PieceValue[pt];
+    return v;
 }
 
 //Helper Functions for square indexing and masking
@@ -221,289 +512,378 @@ void Board::unmakeMove(const MoveRecord &rec) {
     return 1ULL << squareIndex(coord);
 }
 
+// Validated move for user input: it must match one of the legal moves.
+// 'to' may carry a promotion letter, e.g. "e8n"; without one pawns promote to a queen
 void Board::movePiece(const std::string& from, const std::string& to) {
-    if (from.size() != 2 || to.size() != 2) {
+    if (from.size() != 2 || to.size() < 2 || to.size() > 3) {
         throw std::invalid_argument("movePiece: expected format 'e2e4'");
     }
     int f = squareIndex(from);
     int t = squareIndex(to);
-    auto rec = makeMove(f, t);
-    // Optionally: could record rec for undo, or print here
-     print();
+    char promo = to.size() == 3 ? char(to[2] - 'a' + 'A') : 'Q';
+
+    MoveList legal;
+    generateAllLegalMoves(legal);
+    for (Move m : legal) {
+        if (m.from() == f && m.to() == t && (!m.isPromotion() || m.promotion() == promo)) {
+            makeMove(m);
+            print();
+            return;
+        }
+    }
+    throw std::invalid_argument("movePiece: illegal move");
 }
 
-// Constants for pawn double-move ranks
+// Constants for pawn double-move ranks and promotion ranks
+static constexpr uint64_t RANK_1 = 0x00000000000000FFULL;
 static constexpr uint64_t RANK_2 = 0x000000000000FF00ULL;
 static constexpr uint64_t RANK_7 = 0x00FF000000000000ULL;
+static constexpr uint64_t RANK_8 = 0xFF00000000000000ULL;
 
-// Move Generation Functions
-// Functions were optimized from the original code to use bitboards and precomputed attack tables
-// Before I tried to manually check each square, now I use bitwise operations and precomputed masks for efficiency
-// This allows for faster move generation and better performance in the chess engine
-// Each function generates pseudo-legal moves for the respective piece type, considering the current board state
-std::vector<int> Board::generatePawnMoves(int from) const {
-    std::vector<int> moves;
-    uint64_t all    = getAllPieces();
-    uint64_t own    = sideToMove == WHITE ? getWhitePieces() : getBlackPieces();
-    uint64_t opp    = sideToMove == WHITE ? getBlackPieces() : getWhitePieces();
-    uint64_t fw     = 1ULL << from;
-    uint64_t push;
-
-    if (sideToMove == WHITE) {
-        // single push
-        push = (fw << 8) & ~all;
-        if (push) {
-            moves.push_back(__builtin_ctzll(push));
-            // double push
-            uint64_t push2 = (push << 8) & ~all;
-            if ((fw & RANK_2) && push2)
-                moves.push_back(__builtin_ctzll(push2));
-        }
-        // captures
-        uint64_t caps = PAWN_ATTACKS_WHITE[from] & opp;
-        while (caps) {
-            int t = __builtin_ctzll(caps);
-            moves.push_back(t);
-            caps &= caps - 1;
-        }
+// Add a pawn move, expanding it into the four promotions when it reaches the last rank
+static inline void addPawnMove(MoveList& moves, int from, int to, bool capture) {
+    if ((1ULL << to) & (RANK_1 | RANK_8)) {
+        int base = capture ? PROMO_KNIGHT_CAPTURE : PROMO_KNIGHT;
+        for (int p = 3; p >= 0; --p) moves.add(Move(from, to, base + p));
     } else {
-        // single push
-        push = (fw >> 8) & ~all;
-        if (push) {
-            moves.push_back(__builtin_ctzll(push));
-            // double push
-            uint64_t push2 = (push >> 8) & ~all;
-            if ((fw & RANK_7) && push2)
-                moves.push_back(__builtin_ctzll(push2));
-        }
-        // captures
-        uint64_t caps = PAWN_ATTACKS_BLACK[from] & opp;
-        while (caps) {
-            int t = __builtin_ctzll(caps);
-            moves.push_back(t);
-            caps &= caps - 1;
-        }
-    }
-    return moves;
-}
-std::vector<int> Board::generateKnightMoves(int from) const {
-    std::vector<int> moves;
-    uint64_t mask = KNIGHT_ATTACKS[from] & ~(sideToMove == WHITE ? getWhitePieces() : getBlackPieces());
-    while (mask) {
-        int t = __builtin_ctzll(mask);
-        moves.push_back(t);
-        mask &= mask - 1;
-    }
-    return moves;
-}
-std::vector<int> Board::generateKingMoves(int from) const {
-    std::vector<int> moves;
-    uint64_t own  = sideToMove == WHITE ? getWhitePieces() : getBlackPieces();
-    uint64_t mask = KING_ATTACKS[from] & ~own;
-    while (mask) {
-        int t = __builtin_ctzll(mask);
-        moves.push_back(t);
-        mask &= mask - 1;
-    }
-    return moves;
-}
-std::vector<int> Board::generateRookMoves(int from) const {
-    std::vector<int> moves;
-    uint64_t occ = getAllPieces();
-    uint64_t own = sideToMove == WHITE ? getWhitePieces() : getBlackPieces();
-    uint64_t opp = occ ^ own;
-    int dirs[4] = {8, -8, 1, -1};
-
-    for (int dir : dirs) {
-        int sq = from + dir;
-        while (sq >= 0 && sq < 64 && onSameLine(from, sq, dir)) {
-            uint64_t m = 1ULL << sq;
-            if (own & m) break;
-            moves.push_back(sq);
-            if (opp & m) break;
-            sq += dir;
-        }
-    }
-    return moves;
-}
-std::vector<int> Board::generateBishopMoves(int from) const {
-    std::vector<int> moves;
-    uint64_t occ = getAllPieces();
-    uint64_t own = sideToMove == WHITE ? getWhitePieces() : getBlackPieces();
-    uint64_t opp = occ ^ own;
-    int dirs[4] = {9, -9, 7, -7};
-
-    for (int dir : dirs) {
-        int sq = from + dir;
-        while (sq >= 0 && sq < 64 && onSameDiagonal(from, sq, dir)) {
-            uint64_t m = 1ULL << sq;
-            if (own & m) break;
-            moves.push_back(sq);
-            if (opp & m) break;
-            sq += dir;
-        }
+        moves.add(Move(from, to, capture ? CAPTURE : QUIET));
     }
-    return moves;
-}
-std::vector<int> Board::generateQueenMoves(int from) const {
-    // Queen moves are rook + bishop
-    auto r = generateRookMoves(from);
-    auto b = generateBishopMoves(from);
-    r.insert(r.end(), b.begin(), b.end());
-    return r;
-}
-
-//Generation Helper Functions
-bool Board::onSameLine(int f, int t, int d) const {
-    if (d == 1 || d == -1)
-        return f / 8 == t / 8;
-    return true;
-}
-bool Board::onSameDiagonal(int f, int t, int d) const {
-    int df = (t % 8) - (f % 8);
-    int dr = (t / 8) - (f / 8);
-    return std::abs(df) == std::abs(dr) && ((d == 9 || d == -7) ? df > 0 : df < 0);
 }
-std::vector<int> Board::generatePseudoLegalMovesForSquare(int sq) const {
-    char pc = getPieceAtSquare(sq);
 
-    bool isWhitePiece = (pc >= 'A' && pc <= 'Z');
-    if (pc == '.' || isWhitePiece != (sideToMove == WHITE))
-    return {};
-    
-    switch (pc) {
-        case 'P': case 'p': return generatePawnMoves(sq);
-        case 'N': case 'n': return generateKnightMoves(sq);
-        case 'B': case 'b': return generateBishopMoves(sq);
-        case 'R': case 'r': return generateRookMoves(sq);
-        case 'Q': case 'q': return generateQueenMoves(sq);
-        case 'K': case 'k': return generateKingMoves(sq);
-        default: return {};
+// Add one move per target bit, flagging the ones that land on an enemy piece
+static inline void addMoves(MoveList& moves, int from, uint64_t targets, uint64_t opp) {
+    while (targets) {
+        int t = __builtin_ctzll(targets);
+        moves.add(Move(from, t, (opp >> t) & 1 ? CAPTURE : QUIET));
+        targets &= targets - 1;
     }
 }
 
+// All pieces of either color attacking 'sq', with sliders blocked by 'occ'
+uint64_t Board::attackersTo(int sq, uint64_t occ) const {
+    uint64_t rq = pieces[WHITE][ROOK]   | pieces[BLACK][ROOK]   | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN];
+    uint64_t bq = pieces[WHITE][BISHOP] | pieces[BLACK][BISHOP] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN];
+    return (PAWN_ATTACKS_BLACK[sq] & pieces[WHITE][PAWN])
+         | (PAWN_ATTACKS_WHITE[sq] & pieces[BLACK][PAWN])
+         | (KNIGHT_ATTACKS[sq]     & (pieces[WHITE][KNIGHT] | pieces[BLACK][KNIGHT]))
+         | (KING_ATTACKS[sq]       & (pieces[WHITE][KING]   | pieces[BLACK][KING]))
+         | (rookAttacks(sq, occ)   & rq)
+         | (bishopAttacks(sq, occ) & bq);
+}
 
-// Test whether square 'sq' is attacked by side 'byWhite'
-bool Board::isSquareAttacked(int sq, Color attacker) const {
-    bool attackerIsWhite = (attacker == WHITE);
+// Pieces of one color attacking 'sq', with sliders blocked by 'occ'
+template<Color Attacker>
+uint64_t Board::attackersBy(int sq, uint64_t occ) const {
+    const uint64_t* enemy = pieces[Attacker];
+    return (pawnAttacks<~Attacker>()[sq] & enemy[PAWN])
+         | (KNIGHT_ATTACKS[sq]           & enemy[KNIGHT])
+         | (KING_ATTACKS[sq]             & enemy[KING])
+         | (rookAttacks(sq, occ)         & (enemy[ROOK]   | enemy[QUEEN]))
+         | (bishopAttacks(sq, occ)       & (enemy[BISHOP] | enemy[QUEEN]));
+}
 
-    uint64_t occ           = getAllPieces();
-    uint64_t enemyPawns    = attackerIsWhite ? whitePawns   : blackPawns;
-    uint64_t enemyKnights  = attackerIsWhite ? whiteKnights : blackKnights;
-    uint64_t enemyBishops  = attackerIsWhite ? whiteBishops : blackBishops;
-    uint64_t enemyRooks    = attackerIsWhite ? whiteRooks   : blackRooks;
-    uint64_t enemyQueens = attackerIsWhite ? whiteQueens : blackQueens;
-    uint64_t enemyKing = attackerIsWhite ? whiteKing : blackKing;
+// Test whether square 'sq' is attacked by side 'Attacker'
+template<Color Attacker>
+bool Board::isSquareAttacked(int sq) const {
+    const uint64_t* enemy = pieces[Attacker];
+    uint64_t occ = allPieces;
 
     // 1) Knight
-    if (KNIGHT_ATTACKS[sq] & enemyKnights)
+    if (KNIGHT_ATTACKS[sq] & enemy[KNIGHT])
         return true;
 
-   // 2) Pawn attacks
-    if (attackerIsWhite) {
-    bool pawnHit = (PAWN_ATTACKS_BLACK[sq] & enemyPawns);
-    if (pawnHit) {
-        // std::cerr << "  [DEBUG] White pawn attack detected on sq " 
-        //         << Board::idxToCoord(sq) << "\n";
+    // 2) Pawn attacks (look backwards from the target with the defender's pattern)
+    if (pawnAttacks<~Attacker>()[sq] & enemy[PAWN])
         return true;
-    }
-    } else {
-    bool pawnHit = (PAWN_ATTACKS_WHITE[sq] & enemyPawns);
-    if (pawnHit) {
-        // std::cerr << "  [DEBUG] Black pawn attack detected on sq " 
-        //         << Board::idxToCoord(sq) << "\n";
-        return true;
-    }
-    }
 
     // 3) King proximity
-    if (KING_ATTACKS[sq] & enemyKing) return true;
+    if (KING_ATTACKS[sq] & enemy[KING]) return true;
 
     // 4) Rook/Queen attacks
-    for (int dir : {8,-8,1,-1}) {
-        for (int t = sq + dir;
-             t >= 0 && t < 64 && onSameLine(sq,t,dir);
-             t += dir) {
-            uint64_t m = 1ULL<<t;
-            if (occ & m) {
-                if ((enemyRooks|enemyQueens) & m) return true;
-                break;
-            }
-        }
-    }
+    if (rookAttacks(sq, occ) & (enemy[ROOK] | enemy[QUEEN])) return true;
 
     // 5) Bishop/Queen attacks
-    for (int dir : {9,-9,7,-7}) {
-        for (int t = sq + dir;
-             t >= 0 && t < 64 && onSameDiagonal(sq,t,dir);
-             t += dir) {
-            uint64_t m = 1ULL<<t;
-            if (occ & m) {
-                if ((enemyBishops|enemyQueens) & m) return true;
-                break;
-            }
-        }
-    }
-
-    // std::cerr << "[DBG] e8 not attacked by "
-    //         << (attackerIsWhite ? "WHITE\n" : "BLACK\n");
+    if (bishopAttacks(sq, occ) & (enemy[BISHOP] | enemy[QUEEN])) return true;
 
     return false;
 }
 
+bool Board::isSquareAttacked(int sq, Color attacker) const {
+    return attacker == WHITE ? isSquareAttacked<WHITE>(sq) : isSquareAttacked<BLACK>(sq);
+}
+
 bool Board::isKingInCheck(Color c) const {
-    uint64_t kingBB = (c == WHITE ? whiteKing : blackKing);
+    uint64_t kingBB = pieces[c][KING];
     if (!kingBB) return false;
     int kingSq = __builtin_ctzll(kingBB);
 
     // the attacker is the opposite color
-    Color attacker = (c == WHITE ? BLACK : WHITE);
-    return isSquareAttacked(kingSq, attacker);
-}
-
-// Generate all legal moves by making/unmaking and checking
-std::vector<std::pair<int,int>> Board::generateAllLegalMoves() {
-    std::vector<std::pair<int,int>> legal;
-    uint64_t pieces = (sideToMove == WHITE)
-                        ? getWhitePieces()
-                        : getBlackPieces();
-
-    for (int from = 0; from < 64; ++from) {
-        if (!(pieces & (1ULL << from))) continue;
-        auto targets = generatePseudoLegalMovesForSquare(from);
-        for (int to : targets) {
-            MoveRecord rec;
-            try {
-                // try to make the move; makeMove will throw if it leaves king in check
-                rec = makeMove(from, to);
-            } catch (const std::invalid_argument&) {
-                // illegal (king in check) → skip
-                continue;
-            }
-            // if we got here, makeMove succeeded, so it’s legal
-            legal.emplace_back(from, to);
-            unmakeMove(rec);
+    return c == WHITE ? isSquareAttacked<BLACK>(kingSq) : isSquareAttacked<WHITE>(kingSq);
+}
+
+// Generate all legal moves directly.
+// Checkers and pinned pieces are computed once; every non-king move is then restricted to the
+// check-evasion mask (capture or block the checker) and, if pinned, to the line through its king.
+// King moves are tested against the attack map with the king lifted off the board.
+// GEN_CAPTURES narrows targets to enemy pieces plus pawn promotions (quiescence search, the move
+// picker's first stage); GEN_QUIETS produces the rest, so the two together are GEN_ALL.
+// Instantiated per color, so pawn directions, ranks and castling squares are all constants.
+template<Color Us, Board::GenType Type>
+void Board::generateLegal(MoveList& moves) const {
+    constexpr bool     Captures   = Type != GEN_QUIETS;
+    constexpr bool     Quiets     = Type != GEN_CAPTURES;
+    constexpr Color    Them       = ~Us;
+    constexpr uint64_t StartRank  = Us == WHITE ? RANK_2 : RANK_7;
+    constexpr int      CastleBase = Us == WHITE ? 0 : 56;
+    constexpr uint8_t  OO         = Us == WHITE ? WHITE_OO  : BLACK_OO;
+    constexpr uint8_t  OOO        = Us == WHITE ? WHITE_OOO : BLACK_OOO;
+    constexpr auto forward = [](uint64_t b) { return Us == WHITE ? b << 8 : b >> 8; };
+
+    moves.clear();
+    const uint64_t* own   = pieces[Us];
+    const uint64_t* enemy = pieces[Them];
+    uint64_t us     = occupancy[Us];
+    uint64_t opp    = occupancy[Them];
+    uint64_t occ    = allPieces;
+    uint64_t kingBB = own[KING];
+    int      ksq    = __builtin_ctzll(kingBB);
+
+    uint64_t checkers = attackersBy<Them>(ksq, occ);
+    uint64_t wanted   = (Captures ? opp : 0) | (Quiets ? ~occ : 0);
+
+    // 1) King steps
+    uint64_t targets = KING_ATTACKS[ksq] & ~us & wanted;
+    while (targets) {
+        int t = __builtin_ctzll(targets);
+        targets &= targets - 1;
+        if (!attackersBy<Them>(t, occ ^ kingBB))
+            moves.add(Move(ksq, t, (opp >> t) & 1 ? CAPTURE : QUIET));
+    }
+
+    // Double check: only the king can move
+    if (checkers & (checkers - 1))
+        return;
+
+    // 2) Evasion mask: in single check, capture the checker or interpose
+    uint64_t checkMask = checkers ? (BETWEEN[ksq][__builtin_ctzll(checkers)] | checkers) : ~0ULL;
+    uint64_t targetMask = ~us & checkMask & wanted;
+
+    // 3) Pins: enemy sliders that see the king through exactly one of our pieces
+    uint64_t theirRQ = enemy[ROOK]   | enemy[QUEEN];
+    uint64_t theirBQ = enemy[BISHOP] | enemy[QUEEN];
+    uint64_t snipers = (rookAttacks(ksq, opp) & theirRQ) | (bishopAttacks(ksq, opp) & theirBQ);
+    uint64_t pinned  = 0;
+    while (snipers) {
+        int s = __builtin_ctzll(snipers);
+        snipers &= snipers - 1;
+        uint64_t between = BETWEEN[ksq][s] & occ;
+        if (between && !(between & (between - 1)) && (between & us))
+            pinned |= between;
+    }
+
+    // 4) Knights (a pinned knight can never move)
+    uint64_t bb = own[KNIGHT] & ~pinned;
+    while (bb) {
+        int from = __builtin_ctzll(bb);
+        bb &= bb - 1;
+        addMoves(moves, from, attacks<KNIGHT>(from, occ) & targetMask, opp);
+    }
+
+    // 5) Sliders, in square order across types (the search breaks ordering ties by list position)
+    uint64_t diag = own[BISHOP] | own[QUEEN];
+    uint64_t orth = own[ROOK]   | own[QUEEN];
+    bb = diag | orth;
+    while (bb) {
+        int from = __builtin_ctzll(bb);
+        uint64_t fromBB = bb & -bb;
+        bb &= bb - 1;
+        uint64_t att = 0;
+        if (diag & fromBB) att |= attacks<BISHOP>(from, occ);
+        if (orth & fromBB) att |= attacks<ROOK>(from, occ);
+        att &= targetMask;
+        if (pinned & fromBB) att &= LINE[ksq][from];
+        addMoves(moves, from, att, opp);
+    }
+
+    // 6) Pawns
+    bb = own[PAWN];
+    while (bb) {
+        int from = __builtin_ctzll(bb);
+        uint64_t fw = bb & -bb;
+        bb &= bb - 1;
+        uint64_t allowed = checkMask;
+        if (pinned & fw) allowed &= LINE[ksq][from];
+
+        uint64_t push  = forward(fw) & ~occ;
+        uint64_t push2 = (Quiets && (fw & StartRank)) ? forward(push) & ~occ : 0;
+        if (!Captures) push &= ~(RANK_1 | RANK_8);
+        if (!Quiets)   push &=   RANK_1 | RANK_8;
+        if (push & allowed)
+            addPawnMove(moves, from, __builtin_ctzll(push), false);
+        if (push2 & allowed)
+            moves.add(Move(from, __builtin_ctzll(push2), DOUBLE_PUSH));
+        if (!Captures)
+            continue;
+
+        uint64_t pawnAtt = pawnAttacks<Us>()[from];
+        uint64_t caps    = pawnAtt & opp & allowed;
+        while (caps) {
+            addPawnMove(moves, from, __builtin_ctzll(caps), true);
+            caps &= caps - 1;
+        }
+
+        // En passant removes two pieces from one rank, so test the resulting position directly
+        if (epSquare >= 0 && (pawnAtt & (1ULL << epSquare))) {
+            uint64_t capBB    = 1ULL << (epSquare ^ 8);
+            uint64_t occAfter = (occ ^ fw ^ capBB) | (1ULL << epSquare);
+            if (!(attackersBy<Them>(ksq, occAfter) & ~capBB))
+                moves.add(Move(from, epSquare, EN_PASSANT));
         }
     }
-    return legal;
-}
-
-// Helper to pick bitboard reference by piece char
-uint64_t& Board::pieceBitboard(char piece) {
-    switch (piece) {
-        case 'P': return whitePawns;
-        case 'N': return whiteKnights;
-        case 'B': return whiteBishops;
-        case 'R': return whiteRooks;
-        case 'Q': return whiteQueens;
-        case 'K': return whiteKing;
-        case 'p': return blackPawns;
-        case 'n': return blackKnights;
-        case 'b': return blackBishops;
-        case 'r': return blackRooks;
-        case 'q': return blackQueens;
-        case 'k': return blackKing;
-    }
-    static uint64_t dummy = 0;
-    return dummy;
+
+    // 7) Castling: not out of, through or into check
+    if (Quiets && !checkers) {
+        if ((castlingRights & OO) && !(occ & (0x60ULL << CastleBase))
+            && !isSquareAttacked<Them>(CastleBase + 5) && !isSquareAttacked<Them>(CastleBase + 6))
+            moves.add(Move(CastleBase + 4, CastleBase + 6, KING_CASTLE));
+        if ((castlingRights & OOO) && !(occ & (0x0EULL << CastleBase))
+            && !isSquareAttacked<Them>(CastleBase + 3) && !isSquareAttacked<Them>(CastleBase + 2))
+            moves.add(Move(CastleBase + 4, CastleBase + 2, QUEEN_CASTLE));
+    }
+}
+
+void Board::generateAllLegalMoves(MoveList& legal) const {
+    if (sideToMove == WHITE) generateLegal<WHITE, GEN_ALL>(legal);
+    else                     generateLegal<BLACK, GEN_ALL>(legal);
+}
+void Board::generateLegalCaptures(MoveList& captures) const {
+    if (sideToMove == WHITE) generateLegal<WHITE, GEN_CAPTURES>(captures);
+    else                     generateLegal<BLACK, GEN_CAPTURES>(captures);
+}
+void Board::generateLegalQuiets(MoveList& quiets) const {
+    if (sideToMove == WHITE) generateLegal<WHITE, GEN_QUIETS>(quiets);
+    else                     generateLegal<BLACK, GEN_QUIETS>(quiets);
+}
+
+// First the move must be pseudo-legal with exactly the flags the generator would give it, then
+// the king must be safe once it's played: every enemy piece that would still attack it (the
+// captured one aside) is checked with the occupancy after the move.
+template<Color Us>
+bool Board::isLegal(Move m) const {
+    constexpr Color    Them       = ~Us;
+    constexpr uint64_t StartRank  = Us == WHITE ? RANK_2 : RANK_7;
+    constexpr uint64_t LastRank   = Us == WHITE ? RANK_8 : RANK_1;
+    constexpr int      Up         = Us == WHITE ? 8 : -8;
+    constexpr int      CastleBase = Us == WHITE ? 0 : 56;
+
+    int      from = m.from(), to = m.to(), flags = m.flags();
+    uint64_t fromBB = 1ULL << from, toBB = 1ULL << to;
+    uint64_t occ    = allPieces;
+    Piece    p      = mailbox[from];
+    if (!m || p == NO_PIECE || colorOf(p) != Us || (occupancy[Us] & toBB))
+        return false;
+    if (flags != EN_PASSANT && m.isCapture() != bool(occupancy[Them] & toBB))
+        return false;
+
+    int ksq = __builtin_ctzll(pieces[Us][KING]);
+    switch (typeOf(p)) {
+    case PAWN: {
+        if (m.isPromotion() != bool(toBB & LastRank))
+            return false;
+        bool ok;
+        if (flags == EN_PASSANT)
+            ok = to == epSquare && (pawnAttacks<Us>()[from] & toBB);
+        else if (flags == DOUBLE_PUSH)
+            ok = (fromBB & StartRank) && to == from + 2 * Up && !(occ & ((1ULL << (from + Up)) | toBB));
+        else if (m.isCapture())
+            ok = (flags == CAPTURE || m.isPromotion()) && (pawnAttacks<Us>()[from] & toBB);
+        else
+            ok = (flags == QUIET || m.isPromotion()) && to == from + Up && !(occ & toBB);
+        if (!ok)
+            return false;
+        break;
+    }
+    case KING:
+        if (flags == KING_CASTLE || flags == QUEEN_CASTLE) {
+            bool    kingSide = flags == KING_CASTLE;
+            uint8_t right    = kingSide ? (Us == WHITE ? WHITE_OO : BLACK_OO) : (Us == WHITE ? WHITE_OOO : BLACK_OOO);
+            int     step1    = kingSide ? 5 : 3, step2 = kingSide ? 6 : 2;
+            return from == CastleBase + 4 && to == CastleBase + step2 && (castlingRights & right)
+                && !(occ & (kingSide ? 0x60ULL << CastleBase : 0x0EULL << CastleBase))
+                && !isSquareAttacked<Them>(from)
+                && !isSquareAttacked<Them>(CastleBase + step1) && !isSquareAttacked<Them>(CastleBase + step2);
+        }
+        if ((flags != QUIET && flags != CAPTURE) || !(KING_ATTACKS[from] & toBB))
+            return false;
+        return !(attackersBy<Them>(to, occ ^ fromBB) & ~toBB);
+    default:
+        if (flags != QUIET && flags != CAPTURE)
+            return false;
+        uint64_t att = typeOf(p) == KNIGHT ? attacks<KNIGHT>(from, occ)
+                     : typeOf(p) == BISHOP ? attacks<BISHOP>(from, occ)
+                     : typeOf(p) == ROOK   ? attacks<ROOK>(from, occ)
+                     :                       attacks<QUEEN>(from, occ);
+        if (!(att & toBB))
+            return false;
+    }
+
+    uint64_t capBB    = flags == EN_PASSANT ? 1ULL << (to ^ 8) : toBB;
+    uint64_t occAfter = (occ ^ fromBB ^ (capBB & occ)) | toBB;
+    return !(attackersBy<Them>(ksq, occAfter) & ~capBB);
+}
+
+bool Board::isLegal(Move m) const {
+    return sideToMove == WHITE ? isLegal<WHITE>(m) : isLegal<BLACK>(m);
+}
+
+// Least valuable piece of 'side' within 'set', or NO_PIECE_TYPE
+static inline PieceType leastValuable(const uint64_t* own, uint64_t set, uint64_t& fromBB) {
+    for (int pt = PAWN; pt <= KING; ++pt) {
+        if (uint64_t bb = own[pt] & set) {
+            fromBB = bb & -bb;
+            return PieceType(pt);
+        }
+    }
+    return NO_PIECE_TYPE;
+}
+
+// Static exchange evaluation (swap algorithm): both sides keep recapturing on m.to() with their
+// least valuable attacker and may stop whenever continuing would lose material. Sliders behind
+// a capturer join in as it leaves the board (x-rays); pins are ignored.
+int Board::see(Move m) const {
+    if (m.flags() == KING_CASTLE || m.flags() == QUEEN_CASTLE)
+        return 0;
+
+    int to = m.to();
+    int gain[32], d = 0;
+    uint64_t fromBB = 1ULL << m.from();
+    uint64_t occ    = allPieces;
+    int onSquare    = Eval::PieceValue[typeOf(mailbox[m.from()])];
+
+    gain[0] = m.flags() == EN_PASSANT ? Eval::PieceValue[PAWN]
+            : m.isCapture()           ? Eval::PieceValue[typeOf(mailbox[to])] : 0;
+    if (m.flags() == EN_PASSANT)
+        occ ^= 1ULL << (to ^ 8);
+    if (m.isPromotion()) {
+        onSquare = Eval::PieceValue[promotionType(m)];
+        gain[0] += onSquare - Eval::PieceValue[PAWN];
+    }
+
+    Color side = colorOf(mailbox[m.from()]);
+    do {
+        ++d;
+        gain[d] = onSquare - gain[d - 1];          // value if the other side recaptures
+        if (std::max(-gain[d - 1], gain[d]) < 0)    // neither side would continue from here
+            break;
+        occ  ^= fromBB;
+        side  = ~side;
+        PieceType pt = leastValuable(pieces[side], attackersTo(to, occ) & occ, fromBB);
+        if (pt == NO_PIECE_TYPE)
+            break;
+        onSquare = Eval::PieceValue[pt];
+    } while (d < 31);
+
+    while (--d)
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+    return gain[0];
 }
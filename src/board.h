@@ -3,79 +3,235 @@
 #include <cstdint>
 #include <array>
 #include <string>
-#include <vector>
-#include <utility>
+#include "move.h"
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace NNUE { class AccumulatorStack; }
 
 enum Color { WHITE, BLACK };
+constexpr Color operator~(Color c) { return Color(c ^ 1); }
+
+// Piece types index the [color][type] bitboards, Eval::PieceValue and the PST tables
+enum PieceType : uint8_t { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING, NO_PIECE_TYPE };
+
+// Colored pieces: white PNBRQK are 0-5, black pnbrqk are 6-11. NO_PIECE marks an empty square.
+enum Piece : uint8_t {
+    W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
+    B_PAWN, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING,
+    NO_PIECE
+};
+constexpr Piece     makePiece(Color c, PieceType pt) { return Piece(c * 6 + pt); }
+constexpr Color     colorOf  (Piece p)               { return Color(p >= B_PAWN); }
+constexpr PieceType typeOf   (Piece p)               { return PieceType(p >= B_PAWN ? p - B_PAWN : p); }
+
+// Attack set of a leaper (knight, king, pawn) on every square, from its (file, rank) steps
+template<int N>
+constexpr std::array<uint64_t,64> leaperAttacks(const int (&steps)[N][2]) {
+    std::array<uint64_t,64> tbl{};
+    for (int sq = 0; sq < 64; ++sq)
+        for (auto& s : steps) {
+            int f = sq % 8 + s[0], r = sq / 8 + s[1];
+            if (f >= 0 && f < 8 && r >= 0 && r < 8)
+                tbl[sq] |= 1ULL << (r * 8 + f);
+        }
+    return tbl;
+}
+constexpr int KNIGHT_STEPS[8][2]     = {{1,2},{2,1},{2,-1},{1,-2},{-1,-2},{-2,-1},{-2,1},{-1,2}};
+constexpr int KING_STEPS[8][2]       = {{1,0},{1,1},{0,1},{-1,1},{-1,0},{-1,-1},{0,-1},{1,-1}};
+constexpr int WHITE_PAWN_STEPS[2][2] = {{-1,1},{1,1}};
+constexpr int BLACK_PAWN_STEPS[2][2] = {{-1,-1},{1,-1}};
 
 class Board {
 public:
 
     // Side to move
-    Color sideToMove; 
-    
-    // Starting bitboards
-    uint64_t whitePawns, whiteKnights, whiteBishops, whiteRooks, whiteQueens, whiteKing;
-    uint64_t blackPawns, blackKnights, blackBishops, blackRooks, blackQueens, blackKing;
+    Color sideToMove = WHITE;
+
+    // Castling rights (bit set) and en passant target square (-1 if none)
+    enum CastlingRight : uint8_t { WHITE_OO = 1, WHITE_OOO = 2, BLACK_OO = 4, BLACK_OOO = 8 };
+    uint8_t castlingRights = 0;
+    int     epSquare       = -1;
+
+    // Zobrist key of the position, updated incrementally by makeMove/unmakeMove
+    uint64_t hashKey = 0;
+
+    // Zobrist key of the pawns alone (pawn structure cache)
+    uint64_t pawnKey = 0;
+
+    // Running evaluation terms (white minus black), updated by makeMove/unmakeMove from
+    // Eval::PieceValue and the PST tables so the static evaluation costs O(1)
+    int      material = 0;
+    int      psqt     = 0;
+
+    // Piece placement: bitboards by [color][type], cached occupancy and a mailbox for O(1)
+    // lookup by square. makeMove/unmakeMove keep all three in sync.
+    uint64_t pieces[2][6] = {};
+    uint64_t occupancy[2] = {};
+    uint64_t allPieces    = 0;
+    Piece    mailbox[64]  = {};
+
+    // NNUE accumulators kept in step with makeMove/unmakeMove (null when detached). The link is
+    // never copied: a copied or reassigned board (including one reloaded by setFen) is detached.
+    struct NnueLink {
+        NNUE::AccumulatorStack* stack = nullptr;
+        NnueLink() = default;
+        NnueLink(const NnueLink&) {}
+        NnueLink& operator=(const NnueLink&) { stack = nullptr; return *this; }
+    } nnue;
+    void attachNnue(NNUE::AccumulatorStack* stack);   // recomputes the stack's root; nullptr detaches
 
     // Constructor
     Board();
 
+    // Standard starting position
+    static constexpr const char* START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    // Load a FEN position (move counters are accepted but ignored); throws std::invalid_argument on
+    // malformed placement, pawns on a back rank, the side not to move in check, or an en passant
+    // square no pawn just skipped. Castling rights without their king and rook at home are dropped.
+    void     setFen(const std::string& fen);
+
     // Occupancy helpers
-    uint64_t getWhitePieces() const;
-    uint64_t getBlackPieces() const;
-    uint64_t getAllPieces()   const;
+    uint64_t getPieces(Color c, PieceType pt) const { return pieces[c][pt]; }
+    uint64_t getPieces(Color c)               const { return occupancy[c]; }
+    uint64_t getAllPieces()                   const { return allPieces; }
+    Piece    pieceOn(int sq)                  const { return mailbox[sq]; }
+
+    // Full Zobrist recomputation (initialisation and debugging)
+    uint64_t computeHash() const;
+    uint64_t computePawnKey() const;
 
     // I/O
     void     print() const;
-    char     getPieceAtSquare(int sq) const;
+    char     getPieceAtSquare(int sq) const;     // 'P'..'k', or '.' if empty
 
     // Algebraic moves
     void     movePiece(const std::string& from, const std::string& to);
     int      squareIndex(const std::string& coord) const;
     uint64_t squareMask (const std::string& coord) const;
 
-    // Pseudo-legal generators
-    std::vector<int> generatePawnMoves  (int from) const;
-    std::vector<int> generateKnightMoves(int from) const;
-    std::vector<int> generateBishopMoves(int from) const;
-    std::vector<int> generateRookMoves  (int from) const;
-    std::vector<int> generateQueenMoves (int from) const;
-    std::vector<int> generateKingMoves  (int from) const;
-
-    // Precomputed attack tables
-    static const std::array<uint64_t,64> KNIGHT_ATTACKS;
-    static const std::array<uint64_t,64> KING_ATTACKS;
-    static const std::array<uint64_t,64> PAWN_ATTACKS_WHITE;
-    static const std::array<uint64_t,64> PAWN_ATTACKS_BLACK;
-
-    // Internals
-    bool              onSameLine    (int from, int to, int dir) const;
-    bool              onSameDiagonal(int from, int to, int dir) const;
-    std::vector<int>  generatePseudoLegalMovesForSquare(int square) const;
+    // Precomputed attack tables, built at compile time
+    static constexpr std::array<uint64_t,64> KNIGHT_ATTACKS     = leaperAttacks(KNIGHT_STEPS);
+    static constexpr std::array<uint64_t,64> KING_ATTACKS       = leaperAttacks(KING_STEPS);
+    static constexpr std::array<uint64_t,64> PAWN_ATTACKS_WHITE = leaperAttacks(WHITE_PAWN_STEPS);
+    static constexpr std::array<uint64_t,64> PAWN_ATTACKS_BLACK = leaperAttacks(BLACK_PAWN_STEPS);
+
+    // Squares attacked by a pawn of color C
+    template<Color C>
+    static constexpr const std::array<uint64_t,64>& pawnAttacks() {
+        return C == WHITE ? PAWN_ATTACKS_WHITE : PAWN_ATTACKS_BLACK;
+    }
+
+    // Sliding attacks: one table lookup per rook/bishop ray set.
+    // Indexed with PEXT when compiled for BMI2 (e.g. -march=native), otherwise with fancy magics.
+    // The magics, BETWEEN and LINE are built at compile time; SLIDER_ATTACKS (107k entries, too
+    // many for the compiler's constant evaluator) is filled during static initialization.
+    struct Magic {
+        uint64_t mask;     // relevant occupancy, board edges stripped
+        uint64_t magic;
+        uint32_t offset;   // start of this square's slice in SLIDER_ATTACKS
+        uint32_t shift;    // 64 - popcount(mask)
+
+        uint32_t index(uint64_t occ) const {
+#if defined(__BMI2__)
+            return offset + (uint32_t)_pext_u64(occ, mask);
+#else
+            return offset + (uint32_t)(((occ & mask) * magic) >> shift);
+#endif
+        }
+    };
+    static constexpr int SLIDER_TABLE_SIZE = 102400 + 5248;   // rook + bishop slices
+    static const std::array<Magic,64> ROOK_MAGICS;
+    static const std::array<Magic,64> BISHOP_MAGICS;
+    static const std::array<uint64_t,SLIDER_TABLE_SIZE> SLIDER_ATTACKS;
+
+    static uint64_t rookAttacks  (int sq, uint64_t occ) { return SLIDER_ATTACKS[ROOK_MAGICS[sq].index(occ)]; }
+    static uint64_t bishopAttacks(int sq, uint64_t occ) { return SLIDER_ATTACKS[BISHOP_MAGICS[sq].index(occ)]; }
+    static uint64_t queenAttacks (int sq, uint64_t occ) { return rookAttacks(sq, occ) | bishopAttacks(sq, occ); }
+
+    // Attacks of a piece type other than a pawn, resolved at compile time
+    template<PieceType Pt>
+    static uint64_t attacks(int sq, uint64_t occ) {
+        if constexpr (Pt == KNIGHT) return KNIGHT_ATTACKS[sq];
+        if constexpr (Pt == BISHOP) return bishopAttacks(sq, occ);
+        if constexpr (Pt == ROOK)   return rookAttacks(sq, occ);
+        if constexpr (Pt == QUEEN)  return queenAttacks(sq, occ);
+        if constexpr (Pt == KING)   return KING_ATTACKS[sq];
+    }
+
+    // Squares strictly between two aligned squares, and the full line through them (0 if not aligned)
+    static const std::array<std::array<uint64_t,64>,64> BETWEEN;
+    static const std::array<std::array<uint64_t,64>,64> LINE;
 
     // Optimized make/unmake
     struct MoveRecord {
-        int     from, to;
-        uint64_t fromMask, toMask;
-        char    movedPiece, capturedPiece;
-        Color   prevSide;
+        Move     move;
+        Piece    captured;
+        uint8_t  prevCastling;
+        int      prevEpSquare;
+        uint64_t prevHash;
+        uint64_t prevPawnKey;
+        int      prevMaterial, prevPsqt;
     };
-    MoveRecord makeMove   (int from, int to);
+    MoveRecord makeMove   (Move m);     // unchecked: m must come from generateAllLegalMoves
     void       unmakeMove (const MoveRecord& rec);
 
+    // Null move for search pruning: passes the turn (never while in check). The record's move is null.
+    MoveRecord makeNullMove  ();
+    void       unmakeNullMove(const MoveRecord& rec);
+
+    // Knights, bishops, rooks and queens of one side in centipawns (zugzwang guard)
+    int        nonPawnMaterial(Color c) const;
+
     // Helper to convert 0-63 square index to coordinate
         static std::string idxToCoord(int idx) {
         char file = 'a' + (idx % 8);
         char rank = '1' + (idx / 8);
         return std::string{file, rank};
     }
+    // Coordinate form of a move, e.g. "e2e4" or "e7e8q"
+    static std::string moveToString(Move m) {
+        std::string s = idxToCoord(m.from()) + idxToCoord(m.to());
+        if (m.isPromotion()) s += char(m.promotion() - 'A' + 'a');
+        return s;
+    }
     
     // Fast attack & legal-move API
+    uint64_t                          attackersTo        (int sq, uint64_t occ)      const;   // both colors
     bool                              isSquareAttacked   (int sq, Color attacker)    const;
     bool                              isKingInCheck      (Color c)          const;
-    std::vector<std::pair<int,int>>   generateAllLegalMoves() ;
+    void                              generateAllLegalMoves(MoveList& legal) const;
+    void                              generateLegalCaptures(MoveList& captures) const;   // captures and promotions
+    void                              generateLegalQuiets(MoveList& quiets) const;       // everything else
+
+    // Whether m is one of the moves generateAllLegalMoves would produce, checked directly without
+    // generating (hash and killer moves, which may come from another position)
+    bool                              isLegal(Move m) const;
+
+    // Static exchange evaluation: material won (centipawns, may be negative) by playing m and
+    // letting both sides trade on its target square for as long as it pays
+    int                               see(Move m) const;
+
+private:
+    // Color-specialized bodies of the public functions above, which dispatch on sideToMove
+    enum GenType { GEN_ALL, GEN_CAPTURES, GEN_QUIETS };
+    template<Color Us, GenType Type>
+    void generateLegal(MoveList& moves) const;
+    template<Color Us>
+    bool isLegal(Move m) const;
+    template<Color Us>
+    MoveRecord makeMove(Move m);
+    template<Color Us>
+    void unmakeMove(const MoveRecord& rec);
+    template<Color Attacker>
+    bool isSquareAttacked(int sq) const;
+    template<Color Attacker>
+    uint64_t attackersBy(int sq, uint64_t occ) const;
 
-    // Piece-to-bitboard mapper
-    uint64_t& pieceBitboard(char piece);
+    // Placement primitives: bitboards, occupancy and mailbox only (no hash/eval bookkeeping)
+    void addPiece   (Piece p, int sq);
+    void removePiece(int sq);
+    void shiftPiece (int from, int to);
 };
@@ -0,0 +1,39 @@
+#pragma once
+#include "board.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Opening book in the Polyglot .bin layout: 16-byte big-endian entries (uint64 key, uint16 move,
+// uint16 weight, uint32 learn) sorted by key. The file is memory-mapped and searched in place, so
+// opening even a very large book costs nothing up front.
+//
+// Keys are standard Polyglot hashes (the published Random64 table), so third-party Polyglot books
+// can be probed and books written by "book build" can be read by other Polyglot tools.
+namespace Book {
+
+  struct Entry {
+    Move move;
+    int  weight = 0;
+  };
+
+  // Map a book file and use it from now on; replaces any previous book.
+  // Returns false and leaves the previous state untouched on error.
+  bool open(const std::string& path, std::string& error);
+  bool isOpen();
+
+  // Polyglot key of a position
+  uint64_t key(const Board& board);
+
+  // Legal book moves for the position, in file order (heaviest first for built books)
+  std::vector<Entry> entries(const Board& board);
+
+  // Weighted random pick among the position's book moves; a null Move when out of book
+  Move probe(const Board& board);
+
+  // Command-line entry point for the "book" mode:
+  //   book build <games.pgn> <out.bin> [--plies N]   book from the first N plies of every game
+  //   book probe <book.bin> [fen]                    list the book moves of a position
+  // Returns the process exit code.
+  int run(int argc, char** argv);
+}
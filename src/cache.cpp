@@ -0,0 +1,165 @@
+#include "cache.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Cache {
+
+  constexpr char     MAGIC[4]    = { 'C', 'B', 'A', 'C' };
+  constexpr uint32_t VERSION     = 1;
+  constexpr size_t   HEADER_SIZE = 64;
+  constexpr int      BUCKET_SIZE = 4;
+
+  struct Header {
+    char     magic[4];
+    uint32_t version;
+    uint64_t bucketCount;
+  };
+
+  // check = key ^ data; data: move 0-15 | score 16-31 | depth 32-39 | bound 40-41
+  struct Entry {
+    uint64_t check;
+    uint64_t data;
+  };
+  struct alignas(64) Bucket {
+    Entry entries[BUCKET_SIZE];
+  };
+
+  static int     fd          = -1;     // kept open for flock
+  static Bucket* buckets     = nullptr;
+  static size_t  bucketCount = 0;
+  static size_t  mappingSize = 0;
+
+  static uint64_t pack(const TTData& d) {
+    return uint64_t(d.move.data)
+         | uint64_t(uint16_t(int16_t(d.score))) << 16
+         | uint64_t(uint8_t(d.depth)) << 32
+         | uint64_t(d.bound) << 40;
+  }
+  static TTData unpack(uint64_t v) {
+    TTData d;
+    d.move.data = uint16_t(v);
+    d.score     = int16_t(uint16_t(v >> 16));
+    d.depth     = int((v >> 32) & 0xFF);
+    d.bound     = Bound((v >> 40) & 3);
+    return d;
+  }
+
+  // The mapping is shared with other processes: every access is a relaxed atomic
+  static uint64_t load(uint64_t& word)              { return std::atomic_ref<uint64_t>(word).load(std::memory_order_relaxed); }
+  static void     save(uint64_t& word, uint64_t v)  { std::atomic_ref<uint64_t>(word).store(v, std::memory_order_relaxed); }
+
+  static Bucket& bucketOf(uint64_t key) {
+    return buckets[size_t((unsigned __int128)key * bucketCount >> 64)];
+  }
+
+  // Holds the file's exclusive lock for its lifetime
+  struct FileLock {
+    explicit FileLock(int fd) : fd(fd) { while (flock(fd, LOCK_EX) != 0 && errno == EINTR) {} }
+    ~FileLock() { flock(fd, LOCK_UN); }
+    int fd;
+  };
+
+  bool open(const std::string& path, size_t mb, std::string& error) {
+    int f = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (f < 0) {
+      error = "cannot open " + path;
+      return false;
+    }
+
+    // Creation and validation under the lock, so two processes never both initialize the file
+    size_t size;
+    {
+      FileLock lock(f);
+      struct stat st;
+      if (fstat(f, &st) != 0) {
+        ::close(f);
+        error = "cannot stat " + path;
+        return false;
+      }
+      Header h{};
+      if (st.st_size == 0) {
+        std::memcpy(h.magic, MAGIC, sizeof MAGIC);
+        h.version     = VERSION;
+        h.bucketCount = std::max<size_t>(1, (mb << 20) / sizeof(Bucket));
+        size          = HEADER_SIZE + h.bucketCount * sizeof(Bucket);
+        if (ftruncate(f, off_t(size)) != 0 || pwrite(f, &h, sizeof h, 0) != ssize_t(sizeof h)) {
+          ::close(f);
+          error = "cannot create " + path;
+          return false;
+        }
+      } else {
+        if (pread(f, &h, sizeof h, 0) != ssize_t(sizeof h) || std::memcmp(h.magic, MAGIC, sizeof MAGIC) != 0
+            || h.version != VERSION || h.bucketCount == 0
+            || size_t(st.st_size) != HEADER_SIZE + h.bucketCount * sizeof(Bucket)) {
+          ::close(f);
+          error = path + ": not an analysis cache of this version";
+          return false;
+        }
+        size = size_t(st.st_size);
+      }
+      void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, f, 0);
+      if (p == MAP_FAILED) {
+        ::close(f);
+        error = "cannot map " + path;
+        return false;
+      }
+
+      if (buckets) {
+        munmap(reinterpret_cast<char*>(buckets) - HEADER_SIZE, mappingSize);
+        ::close(fd);
+      }
+      fd          = f;
+      buckets     = reinterpret_cast<Bucket*>(static_cast<char*>(p) + HEADER_SIZE);
+      bucketCount = h.bucketCount;
+      mappingSize = size;
+    }
+    return true;
+  }
+
+  bool isOpen() { return buckets != nullptr; }
+
+  bool probe(uint64_t key, TTData& out) {
+    if (!buckets)
+      return false;
+    for (Entry& e : bucketOf(key).entries) {
+      uint64_t data = load(e.data);
+      if ((load(e.check) ^ data) == key && data) {
+        out = unpack(data);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void store(const std::vector<Record>& records) {
+    if (!buckets || records.empty())
+      return;
+    FileLock lock(fd);
+    for (const Record& r : records) {
+      // Same position, else an empty slot, else the shallowest entry
+      Entry* victim = nullptr;
+      for (Entry& e : bucketOf(r.key).entries) {
+        uint64_t data = load(e.data);
+        if ((load(e.check) ^ data) == r.key || !data) {
+          victim = &e;
+          break;
+        }
+        if (!victim || unpack(data).depth < unpack(load(victim->data)).depth)
+          victim = &e;
+      }
+      uint64_t old = load(victim->data);
+      if (old && unpack(old).depth > r.data.depth)
+        continue;
+      uint64_t data = pack(r.data);
+      save(victim->data,  data);
+      save(victim->check, r.key ^ data);
+    }
+  }
+}
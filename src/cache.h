@@ -0,0 +1,36 @@
+#pragma once
+#include "tt.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Persistent analysis cache: search results kept on disk across runs, keyed by Board::hashKey.
+//
+// The file is a fixed-size hash table (a 64-byte header, then 64-byte buckets of four 16-byte
+// entries) mapped shared into every process that opens it, so lookups read the page cache
+// directly with no load step. Entries use the transposition table's check-word scheme: a reader
+// accepts an entry only if its two words XOR back to the key, so reads need no lock. Writers take
+// an exclusive flock on the file for each batch; several processes on one host can share a cache.
+// Replacement is depth-preferred: an entry is only ever replaced by one searched at least as deep.
+//
+// Scores are stored as the transposition table stores them (mate scores relative to the node).
+// The keys depend on this engine's Zobrist constants; the version field changes with them.
+namespace Cache {
+
+  constexpr size_t DEFAULT_MB = 16;
+
+  struct Record {
+    uint64_t key;
+    TTData   data;
+  };
+
+  // Map 'path', creating it with 'mb' megabytes if it doesn't exist (an existing file keeps its
+  // size); replaces any open cache. Returns false and leaves the previous state untouched on error.
+  bool open(const std::string& path, size_t mb, std::string& error);
+  bool isOpen();
+
+  bool probe(uint64_t key, TTData& out);
+
+  // Write a batch under one lock; each record replaces a shallower entry or is dropped
+  void store(const std::vector<Record>& records);
+}
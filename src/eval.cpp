@@ -1,6 +1,13 @@
 // eval.cpp
 #include "eval.h"
+#include "bitbase.h"
 #include "board.h"
+#include "nnue.h"
+#include <algorithm>
+#include <cstdlib>
+#ifdef EVAL_CHECK
+#include <iostream>
+#endif
 
 // Calculates how many 1 bits in the 64 bit number (Counts pieces on the board)
 static inline int popcount(uint64_t b) {
@@ -12,93 +19,164 @@ static inline int pop_lsb(uint64_t& b) {
     return sq;
 }
 
+// File masks and whole-board pawn spans
+static constexpr uint64_t FILE_A = 0x0101010101010101ULL;
+static constexpr uint64_t FILE_H = FILE_A << 7;
+
+static inline uint64_t northFill(uint64_t b) { b |= b << 8; b |= b << 16; return b | (b << 32); }
+static inline uint64_t southFill(uint64_t b) { b |= b >> 8; b |= b >> 16; return b | (b >> 32); }
+static inline uint64_t eastOne  (uint64_t b) { return (b << 1) & ~FILE_A; }
+static inline uint64_t westOne  (uint64_t b) { return (b >> 1) & ~FILE_H; }
+static inline uint64_t sides    (uint64_t b) { return eastOne(b) | westOne(b); }
+
 namespace Eval {
 
 
-int evaluate(const Board& board) {
-    int sc = materialScore(board)
-        + positionScore(board);
+// O(1): Board keeps material and PST totals up to date in makeMove/unmakeMove, and pawn
+// structure comes from the pawn table. Build with EVAL_CHECK defined (make EVAL_CHECK=1) to
+// verify them against a full recount at every call. A loaded NNUE net takes over completely.
+static int classical(const Board& board, int pawns) {
+#ifdef EVAL_CHECK
+    if (board.material != materialScore(board) || board.psqt != positionScore(board)) {
+        std::cerr << "evaluate: incremental material/psqt " << board.material << "/" << board.psqt
+                  << " != recomputed " << materialScore(board) << "/" << positionScore(board) << "\n";
+        std::abort();
+    }
+#endif
+    int sc = board.material
+        + board.psqt
+        + pawns;
     // always return the score **from** the side‐to‐move’s perspective
     return (board.sideToMove == WHITE) ? sc : -sc;
 }
 
+// Positions a bitbase decides: draws score 0, wins KNOWN_WIN plus material and progress
+// (pawn advanced, lone king driven to the edge and approached), so the search makes headway
+static bool knownEndgame(const Board& board, int& score) {
+    if (popcount(board.allPieces) > Bitbases::MAX_PIECES)
+        return false;
+    Bitbases::Outcome o = Bitbases::probe(board);
+    if (o == Bitbases::UNKNOWN)
+        return false;
+    if (o == Bitbases::DRAW) {
+        score = 0;
+        return true;
+    }
+    Color strong = o == Bitbases::WIN ? board.sideToMove : ~board.sideToMove;
+    int   sk     = __builtin_ctzll(board.pieces[strong][KING]);
+    int   wk     = __builtin_ctzll(board.pieces[~strong][KING]);
+    auto  centerDistance = [](int sq) { return std::max(3 - (sq & 7), (sq & 7) - 4) + std::max(3 - (sq >> 3), (sq >> 3) - 4); };
+    int   kingDistance   = std::abs((sk & 7) - (wk & 7)) + std::abs((sk >> 3) - (wk >> 3));
+
+    score = KNOWN_WIN + board.nonPawnMaterial(strong) + 10 * centerDistance(wk) + 4 * (14 - kingDistance);
+    if (uint64_t pawn = board.pieces[strong][PAWN]) {
+        int rank = __builtin_ctzll(pawn) >> 3;
+        score += PieceValue[PAWN] + 20 * (strong == WHITE ? rank : 7 - rank);
+    }
+    if (o == Bitbases::LOSS)
+        score = -score;
+    return true;
+}
 
-// Calculate the material score of the board, of White - Black
-int materialScore(const Board& board) {
-    int score = 0;
-
-    // Pawns
-    score += popcount(board.whitePawns) * PieceValue[0];
-    score -= popcount(board.blackPawns) * PieceValue[0];
+int evaluate(const Board& board) {
+    if (int score; knownEndgame(board, score))
+        return score;
+    if (NNUE::isLoaded())
+        return NNUE::evaluate(board);
+    return classical(board, pawnScore(board));
+}
 
-    // Knights
-    score += popcount(board.whiteKnights) * PieceValue[1];
-    score -= popcount(board.blackKnights) * PieceValue[1];
+int evaluate(const Board& board, PawnTable& pawns, bool nnue) {
+    if (int score; knownEndgame(board, score))
+        return score;
+    if (nnue && NNUE::isLoaded())
+        return NNUE::evaluate(board);
+    return classical(board, pawns.probe(board));
+}
 
-    // Bishops
-    score += popcount(board.whiteBishops) * PieceValue[2];
-    score -= popcount(board.blackBishops) * PieceValue[2];
+int PawnTable::probe(const Board& board) {
+    Entry& e = entries[board.pawnKey & (SIZE - 1)];
+    ++probes;
+#ifdef EVAL_CHECK
+    if (board.pawnKey != board.computePawnKey()) {
+        std::cerr << "PawnTable::probe: incremental pawn key differs from a recount\n";
+        std::abort();
+    }
+#endif
+    if (e.key == board.pawnKey) {
+        ++hits;
+        return e.score;
+    }
+    e.key   = board.pawnKey;
+    e.score = pawnScore(board);
+    return e.score;
+}
 
-    // Rooks
-    score += popcount(board.whiteRooks) * PieceValue[3];
-    score -= popcount(board.blackRooks) * PieceValue[3];
+// Pawn terms for one side, positive = good for 'Us'. Everything is done on whole bitboards:
+// fills give the squares in front of (or behind) each pawn, shifted sideways for the adjacent files.
+template <Color Us>
+static int pawnTerms(uint64_t own, uint64_t enemy) {
+    auto forward = [](uint64_t b) { return Us == WHITE ? b << 8 : b >> 8; };
+    auto back    = [](uint64_t b) { return Us == WHITE ? b >> 8 : b << 8; };
+    auto ahead   = [](uint64_t b) { return Us == WHITE ? northFill(b) : southFill(b); };
+    auto behind  = [](uint64_t b) { return Us == WHITE ? southFill(b) : northFill(b); };
+
+    uint64_t ownFront     = ahead(forward(own));       // squares in front of our pawns
+    uint64_t ownRear      = behind(back(own));         // squares behind our pawns
+    uint64_t enemyFront   = behind(back(enemy));       // squares in front of theirs, from their side
+    uint64_t ownFiles     = northFill(southFill(own));
+    uint64_t ownAttacks   = sides(forward(own));
+    uint64_t enemyAttacks = sides(back(enemy));
+
+    uint64_t doubled  = own & ownFront;                           // one per extra pawn on a file
+    uint64_t isolated = own & ~sides(ownFiles);
+    // Stop square covered by an enemy pawn and out of reach of our pawns on the adjacent files
+    uint64_t backward = back(forward(own) & enemyAttacks & ~ahead(ownAttacks)) & ~isolated;
+    // No enemy pawn ahead on this or an adjacent file, and not behind one of our own
+    uint64_t passed   = own & ~(enemyFront | sides(enemyFront)) & ~ownRear;
+
+    int score = DOUBLED_PAWN  * popcount(doubled)
+              + ISOLATED_PAWN * popcount(isolated)
+              + BACKWARD_PAWN * popcount(backward);
+    while (passed) {
+        int sq = pop_lsb(passed);
+        score += PASSED_PAWN[Us == WHITE ? sq >> 3 : 7 - (sq >> 3)];
+    }
+    return score;
+}
 
-    // Queens
-    score += popcount(board.whiteQueens) * PieceValue[4];
-    score -= popcount(board.blackQueens) * PieceValue[4];
+int pawnScore(const Board& board) {
+    uint64_t white = board.pieces[WHITE][PAWN], black = board.pieces[BLACK][PAWN];
+    return pawnTerms<WHITE>(white, black) - pawnTerms<BLACK>(black, white);
+}
 
-    // Kings 
-    score += popcount(board.whiteKing) * PieceValue[5];
-    score -= popcount(board.blackKing) * PieceValue[5];
 
+// Calculate the material score of the board, of White - Black
+int materialScore(const Board& board) {
+    int score = 0;
+    for (int pt = PAWN; pt <= KING; ++pt) {
+        score += popcount(board.pieces[WHITE][pt]) * PieceValue[pt];
+        score -= popcount(board.pieces[BLACK][pt]) * PieceValue[pt];
+    }
     return score;
 }
 
 // Calculate the position score of the board, using piece-square tables representing a mid game position.
-// Currently, this is simplified to not consider advanced concepts like king safety or pawn structure, or whether
-// the game is early, mid, or late game. 
+// Currently, this is simplified to not consider advanced concepts like king safety, or whether the game is
+// early, mid, or late game; pawn structure is scored separately by pawnScore.
 int positionScore(const Board& board) {
     int score = 0;
     uint64_t bb;
 
-    // White pieces
-    bb = board.whitePawns;
-    while (bb)                score += PST_PAWN[pop_lsb(bb)];
-
-    bb = board.whiteKnights;
-    while (bb)                score += PST_KNIGHT[pop_lsb(bb)];
-
-    bb = board.whiteBishops;
-    while (bb)                score += PST_BISHOP[pop_lsb(bb)];
-
-    bb = board.whiteRooks;
-    while (bb)                score += PST_ROOK[pop_lsb(bb)];
-
-    bb = board.whiteQueens;
-    while (bb)                score += PST_QUEEN[pop_lsb(bb)];
-
-    bb = board.whiteKing;
-    while (bb)                score += PST_KING[pop_lsb(bb)];
-
-    // Black pieces (mirror the square with sq^56)
-    bb = board.blackPawns;
-    while (bb)                score -= PST_PAWN[pop_lsb(bb) ^ 56];
-
-    bb = board.blackKnights;
-    while (bb)                score -= PST_KNIGHT[pop_lsb(bb) ^ 56];
-
-    bb = board.blackBishops;
-    while (bb)                score -= PST_BISHOP[pop_lsb(bb) ^ 56];
-
-    bb = board.blackRooks;
-    while (bb)                score -= PST_ROOK[pop_lsb(bb) ^ 56];
-
-    bb = board.blackQueens;
-    while (bb)                score -= PST_QUEEN[pop_lsb(bb) ^ 56];
-
-    bb = board.blackKing;
-    while (bb)                score -= PST_KING[pop_lsb(bb) ^ 56];
+    for (int pt = PAWN; pt <= KING; ++pt) {
+        // White pieces
+        bb = board.pieces[WHITE][pt];
+        while (bb)            score += PST[pt][pop_lsb(bb)];
 
+        // Black pieces (mirror the square with sq^56)
+        bb = board.pieces[BLACK][pt];
+        while (bb)            score -= PST[pt][pop_lsb(bb) ^ 56];
+    }
     return score;
 }
 
@@ -86,13 +86,54 @@ inline constexpr int PST_KING[64] = {
     20,  30,  10,   0,   0,  10,  30,  20
 };
 
+// PST lookup by PieceType (pawn..king), written from white's side; black mirrors with sq ^ 56
+inline constexpr const int* PST[6] = {
+    PST_PAWN, PST_KNIGHT, PST_BISHOP, PST_ROOK, PST_QUEEN, PST_KING
+};
+
 // Evaluate pure material balance: white minus black
 int materialScore(const Board& board);
 
 // Evaluate positional component via piece-square tables
 int positionScore(const Board& board);
 
-// Combined static evaluation (material + positional), from side-to-move's perspective
+// Base score of an endgame a bitbase says is won, on top of which progress is rewarded
+inline constexpr int KNOWN_WIN = 10000;
+
+// Pawn structure terms (centipawns per pawn); passed pawns by rank from their own side
+inline constexpr int DOUBLED_PAWN  = -10;
+inline constexpr int ISOLATED_PAWN = -12;
+inline constexpr int BACKWARD_PAWN = -8;
+inline constexpr int PASSED_PAWN[8] = { 0, 5, 10, 15, 25, 40, 60, 0 };
+
+// Evaluate pawn structure (passed, isolated, doubled, backward pawns): white minus black
+int pawnScore(const Board& board);
+
+// Cache of pawnScore keyed by Board::pawnKey. Pawns rarely move between neighbouring nodes, so
+// nearly every probe hits. Each search thread owns one; it is not thread-safe.
+class PawnTable {
+public:
+    static constexpr int SIZE = 1 << 14;   // entries, a power of two
+
+    int  probe(const Board& board);
+    void clear() { entries.fill(Entry{}); }
+
+    uint64_t probes = 0;
+    uint64_t hits   = 0;
+
+private:
+    // Key 0 (no pawns) scores 0, so empty entries need no valid flag
+    struct Entry {
+        uint64_t key   = 0;
+        int      score = 0;
+    };
+    std::array<Entry, SIZE> entries{};
+};
+
+// Combined static evaluation (material + positional + pawn structure), from side-to-move's perspective.
+// The search passes its thread's pawn table; without one the pawn terms are computed directly.
+// nnue = false keeps to the classical evaluation even while a net is loaded.
 int evaluate(const Board& board);
+int evaluate(const Board& board, PawnTable& pawns, bool nnue = true);
 
 }
\ No newline at end of file
@@ -1,10 +1,95 @@
+#include "analyze.h"
+#include "bench.h"
+#include "bitbase.h"
+#include "book.h"
 #include "board.h"
+#include "cache.h"
+#include "match.h"
+#include "nnue.h"
 #include "search.h"
+#include "perft.h"
+#include "uci.h"
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <unistd.h>
 
-int main() {
+// Net picked up from the working directory when no --net is given
+static const char* const DEFAULT_NET = "chess-bot.nnue";
+
+// Remove "<flag> <value>" (anywhere on the command line) and return the value, or "" if absent.
+// Exits with status 2 if the flag has no value.
+static std::string takeOption(int& argc, char** argv, const std::string& flag) {
+  for (int i = 1; i < argc; ++i) {
+    if (argv[i] != flag)
+      continue;
+    if (i + 1 >= argc) {
+      std::cerr << flag << " needs a file name\n";
+      std::exit(2);
+    }
+    std::string value = argv[i + 1];
+    for (int j = i + 2; j <= argc; ++j)   // drop both words, argv[argc] (null) included
+      argv[j - 2] = argv[j];
+    argc -= 2;
+    return value;
+  }
+  return "";
+}
+
+int main(int argc, char** argv) {
+
+  // --net FILE loads an NNUE evaluation net and --book FILE an opening book, for every mode
+  std::string netPath  = takeOption(argc, argv, "--net");
+  std::string bookPath = takeOption(argc, argv, "--book");
+  // --stats FILE appends one JSON line of search statistics per search ("-" = stderr)
+  std::string statsPath = takeOption(argc, argv, "--stats");
+  // --cache FILE keeps search results on disk across runs (created if missing)
+  std::string cachePath = takeOption(argc, argv, "--cache");
+  std::string error;
+  if (!netPath.empty() && !NNUE::load(netPath, error)) {
+    std::cerr << "NNUE: " << error << "\n";
+    return 1;
+  }
+  if (netPath.empty() && access(DEFAULT_NET, R_OK) == 0 && !NNUE::load(DEFAULT_NET, error))
+    std::cerr << "NNUE: " << error << " (using the classical evaluation)\n";
+  if (!bookPath.empty() && !Book::open(bookPath, error)) {
+    std::cerr << "book: " << error << "\n";
+    return 1;
+  }
+  if (!cachePath.empty() && !Cache::open(cachePath, Cache::DEFAULT_MB, error)) {
+    std::cerr << "cache: " << error << "\n";
+    return 1;
+  }
+
+  static std::ofstream statsFile;
+  if (statsPath == "-")
+    Search::dumpStats(&std::cerr);
+  else if (!statsPath.empty()) {
+    statsFile.open(statsPath, std::ios::app);
+    if (!statsFile) {
+      std::cerr << "stats: cannot open " << statsPath << "\n";
+      return 1;
+    }
+    Search::dumpStats(&statsFile);
+  }
+
+  Bitbases::init();
+
+  // Command-line tool modes
+  if (argc > 1 && std::string(argv[1]) == "perft")
+    return Perft::run(argc - 2, argv + 2);
+  if (argc > 1 && std::string(argv[1]) == "analyze")
+    return Analyze::run(argc - 2, argv + 2);
+  if (argc > 1 && std::string(argv[1]) == "bench")
+    return Bench::run(argc - 2, argv + 2);
+  if (argc > 1 && std::string(argv[1]) == "book")
+    return Book::run(argc - 2, argv + 2);
+  if (argc > 1 && std::string(argv[1]) == "match")
+    return Match::run(argc - 2, argv + 2);
+  if (argc > 1 && std::string(argv[1]) == "uci")
+    return UCI::loop();
 
-  
 
   // Welcome message and instructions
   std::cout << "Welcome to the Chess Bot!\n";
@@ -12,9 +97,13 @@ int main() {
   std::cout << "Type 'exit' to quit.\n";
   std::cout << "Enter your preferred difficulty level (1-5): ";
 
-  // Read & Verify difficulty level ('Difficulty' just refers to the level of search depth)
-  int difficulty;
-  std::cin >> difficulty;
+  // Read & Verify difficulty level ('Difficulty' just refers to the level of search depth).
+  // A GUI that starts the engine without arguments sends "uci" here instead.
+  std::string level;
+  std::cin >> level;
+  if (level == "uci")
+    return UCI::loop(true);
+  int difficulty = std::atoi(level.c_str());
   if (difficulty < 1 || difficulty > 5) {
     std::cerr << "Invalid difficulty level. Defaulting to 3.\n";
     difficulty = 3;
@@ -27,7 +116,28 @@ int main() {
   // This sets up the initial position of the chess pieces
   Board board;
   board.print();
-  
+
+  // Pondering: while the human thinks, the engine searches the position after the reply its last
+  // principal variation expects. If that reply is played, the finished search is the answer.
+  // Without an expected reply it searches the human's position one ply deeper, which fills the
+  // table for every reply. Either way, a search that missed is stopped and the normal search
+  // starts on the table it warmed. The difficulty depth is kept: pondering saves waiting time,
+  // it doesn't make the engine play deeper.
+  Board pondered;             // position of the running ponder search
+  bool  pondering   = false;
+  bool  guessed     = false;  // pondered is the position after an expected reply
+  Move  ponderBest;           // written by the search thread, read after Search::wait()
+  auto stopPondering = [&](bool hit) {
+    if (!pondering)
+      return;
+    if (hit)
+      Search::ponderhit();
+    else
+      Search::stop();
+    Search::wait();
+    pondering = false;
+  };
+
   // Main game loop
   // This loop continues until the user decides to exit
   while (true) {
@@ -37,7 +147,8 @@ int main() {
     std::cin >> from >> to;
 
     // Handle exit command
-    if (from == "exit" || to == "exit") {
+    if (!std::cin || from == "exit" || to == "exit") {
+      stopPondering(false);
       std::cout << "Exiting the game. Goodbye!\n";
       break;
     }
@@ -49,20 +160,55 @@ int main() {
       std::cerr << "Illegal move, try again\n";
       continue;
     }
-    
+
     // Print the board after the human move
     std::cout << "You played: " << from << " to " << to << "\n";
     board.print();
 
-    // Engine’s turn → search
-    auto [eFrom, eTo] = Search::findBestMove(board, difficulty);
-    board.movePiece(Board::idxToCoord(eFrom),
-                    Board::idxToCoord(eTo));
+    // Engine’s turn → book move if there is one, then a pondered result, otherwise search
+    bool hit = pondering && guessed && pondered.hashKey == board.hashKey;
+    stopPondering(hit);
+    Move best = Book::probe(board);
+    bool searched = !best;
+    if (!best && hit)
+      best = ponderBest;
+    if (!best)
+      best = Search::findBestMove(board, difficulty);
+    if (!best) {
+      std::cout << (board.isKingInCheck(board.sideToMove) ? "Checkmate, you win!\n" : "Stalemate!\n");
+      break;
+    }
+    board.makeMove(best);
 
     std::cout << "Engine played: "
-              << Board::idxToCoord(eFrom) << " to "
-              << Board::idxToCoord(eTo) << "\n";
+              << Board::idxToCoord(best.from()) << " to "
+              << Board::idxToCoord(best.to())
+              << (best.isPromotion() ? std::string("=") + "NBRQ"[best.flags() & 3] : "") << "\n";
     board.print();
+
+    // The human may have no move left; there is nothing to wait or ponder for then
+    MoveList replies;
+    board.generateAllLegalMoves(replies);
+    if (replies.count == 0) {
+      std::cout << (board.isKingInCheck(board.sideToMove) ? "Checkmate, the engine wins!\n" : "Stalemate!\n");
+      break;
+    }
+
+    // Ponder until the human moves; a book move leaves no line to guess from
+    const std::vector<Move>& pv = Search::lastPV();
+    Search::Limits limits;
+    limits.ponder = true;
+    pondered      = board;
+    guessed       = searched && pv.size() >= 2 && pv[0] == best;
+    if (guessed) {
+      pondered.makeMove(pv[1]);
+      limits.depth = difficulty;
+    } else {
+      limits.depth = difficulty + 1;
+    }
+    ponderBest = Move();
+    pondering  = true;
+    Search::start(pondered, limits, [&ponderBest](Move m) { ponderBest = m; });
   }
   return 0;
 }
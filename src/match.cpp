@@ -0,0 +1,428 @@
+#include "match.h"
+#include "bitbase.h"
+#include "board.h"
+#include "search.h"
+#include "tt.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Match {
+
+  constexpr int      DEFAULT_GAMES  = 200;
+  constexpr uint64_t DEFAULT_NODES  = 20000;
+  constexpr int      DEFAULT_HASH   = 8;       // MB per engine per concurrent game
+  constexpr int      DEFAULT_PLIES  = 8;       // random opening moves without an openings file
+  constexpr int      DEFAULT_REPORT = 10;
+
+  // Adjudication: a side both engines see RESIGN_SCORE behind for RESIGN_PLIES plies in a row
+  // loses; a game whose score stays within DRAW_SCORE for DRAW_PLIES plies after DRAW_FROM_PLY
+  // is drawn; a game that reaches --maxplies is drawn.
+  constexpr int RESIGN_SCORE  = 1000;
+  constexpr int RESIGN_PLIES  = 6;
+  constexpr int DRAW_SCORE    = 10;
+  constexpr int DRAW_PLIES    = 12;
+  constexpr int DRAW_FROM_PLY = 80;
+  constexpr int DEFAULT_MAX_PLIES = 400;
+
+  struct Engine {
+    Search::Params params;
+    Search::Limits limits;
+    bool           clock = false;    // limits.time/inc hold a time control to play with
+  };
+
+  enum Result { WHITE_WINS, BLACK_WINS, DRAW };
+
+  // How games ended, for the summary
+  enum Reason { MATE, STALEMATE, REPETITION, FIFTY_MOVES, BITBASE, RESIGNATION, DRAW_ADJUDICATION,
+                MAX_PLIES, TIME_FORFEIT, REASON_COUNT };
+  static const char* const REASON_NAMES[REASON_COUNT] = {
+    "mate", "stalemate", "repetition", "50 moves", "bitbase", "resignation", "draw adjudication",
+    "max plies", "time forfeit"
+  };
+
+  // "BASE+INC" in ms
+  static void parseTimeControl(const std::string& s, Search::Limits& limits) {
+    size_t plus = s.find('+');
+    int64_t base = std::atoll(s.substr(0, plus).c_str());
+    int64_t inc  = plus == std::string::npos ? 0 : std::atoll(s.substr(plus + 1).c_str());
+    if (base <= 0)
+      throw std::invalid_argument("bad time control '" + s + "'");
+    limits.time[WHITE] = limits.time[BLACK] = base;
+    limits.inc[WHITE]  = limits.inc[BLACK]  = inc;
+  }
+
+  // Apply a SPEC ("nullmove=0,nodes=5000") to an engine; limits in it replace the common ones
+  static void parseSpec(const std::string& spec, Engine& e) {
+    std::istringstream is(spec);
+    std::string item;
+    Search::Limits limits;
+    bool hasLimits = false;
+    while (std::getline(is, item, ',')) {
+      if (item.empty())
+        continue;
+      size_t eq = item.find('=');
+      if (eq == std::string::npos)
+        throw std::invalid_argument("expected key=value, got '" + item + "'");
+      std::string key = item.substr(0, eq), value = item.substr(eq + 1);
+      int v = std::atoi(value.c_str());
+      if      (key == "nnue")       e.params.nnue            = v != 0;
+      else if (key == "rfp")        e.params.reverseFutility = v != 0;
+      else if (key == "rfpmargin")  e.params.rfpMargin       = v;
+      else if (key == "nullmove")   e.params.nullMove        = v != 0;
+      else if (key == "futility")   e.params.futility        = v != 0;
+      else if (key == "lmr")        e.params.lmr             = v != 0;
+      else if (key == "aspiration") e.params.aspirationDelta = std::max(1, v);
+      else if (key == "nodes")    { limits.nodes    = std::strtoull(value.c_str(), nullptr, 10); hasLimits = true; }
+      else if (key == "depth")    { limits.depth    = v;                                         hasLimits = true; }
+      else if (key == "movetime") { limits.movetime = std::atoll(value.c_str());                 hasLimits = true; }
+      else if (key == "tc")       { parseTimeControl(value, limits);                             hasLimits = true; }
+      else throw std::invalid_argument("unknown key '" + key + "'");
+    }
+    if (hasLimits) {
+      e.limits = limits;
+      e.clock  = limits.time[WHITE] > 0;
+    }
+  }
+
+  // FEN or EPD lines (the first four fields); blank lines and '#' comments are skipped
+  static std::vector<Board> readOpenings(const std::string& path) {
+    std::ifstream in(path);
+    if (!in)
+      throw std::runtime_error("cannot open " + path);
+    std::vector<Board> openings;
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+      ++lineNo;
+      std::istringstream is(line);
+      std::string fields[4], fen;
+      if (!(is >> fields[0]) || fields[0][0] == '#')
+        continue;
+      for (int i = 1; i < 4; ++i) is >> fields[i];
+      for (auto& f : fields) fen += (fen.empty() ? "" : " ") + f;
+      try {
+        Board b;
+        b.setFen(fen);
+        MoveList legal;
+        b.generateAllLegalMoves(legal);
+        if (legal.empty() || b.isKingInCheck(~b.sideToMove))
+          throw std::invalid_argument("game already over or illegal");
+        openings.push_back(b);
+      } catch (const std::exception& e) {
+        std::cerr << "match: " << path << ":" << lineNo << ": " << e.what() << " (skipped)\n";
+      }
+    }
+    if (openings.empty())
+      throw std::runtime_error("no usable positions in " + path);
+    return openings;
+  }
+
+  // 'plies' random legal moves from the start position, the same for a given seed
+  static Board randomOpening(int plies, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    while (true) {
+      Board b;
+      MoveList legal;
+      int i = 0;
+      for (; i < plies; ++i) {
+        b.generateAllLegalMoves(legal);
+        if (legal.empty())
+          break;
+        b.makeMove(legal[int(rng() % uint64_t(legal.size()))]);
+      }
+      b.generateAllLegalMoves(legal);
+      if (i == plies && !legal.empty())
+        return b;
+    }
+  }
+
+  // One engine's state for one game: its own search thread data and transposition table, so the
+  // two sides never share what they learned
+  struct Player {
+    std::unique_ptr<Search::ThreadData> td;
+    std::unique_ptr<TranspositionTable> tt;
+
+    explicit Player(size_t hashMB) : tt(std::make_unique<TranspositionTable>(hashMB)) {}
+
+    void newGame(const Engine& e) {
+      td         = std::make_unique<Search::ThreadData>();   // fresh killers and history
+      td->tt     = tt.get();
+      td->params = e.params;
+      tt->clear();
+    }
+  };
+
+  struct GameResult {
+    Result result;
+    Reason reason;
+    int    plies;
+  };
+
+  // Play one game from 'start'; engines[c] plays color c
+  static GameResult playGame(const Board& start, const Engine* engines[2], Player* players[2], int maxPlies) {
+    Board board = start;
+    std::vector<uint64_t> history { board.hashKey };   // since the last irreversible move
+    int64_t clock[2] = { engines[WHITE]->limits.time[WHITE], engines[BLACK]->limits.time[BLACK] };
+    int resignCount[2] = { 0, 0 };                      // plies in a row each side was judged lost
+    int drawCount  = 0;
+    int halfmoves  = 0;
+    for (Color c : { WHITE, BLACK })
+      players[c]->newGame(*engines[c]);
+
+    for (int ply = 0; ; ++ply) {
+      Color us = board.sideToMove;
+      MoveList legal;
+      board.generateAllLegalMoves(legal);
+      if (legal.empty()) {
+        if (!board.isKingInCheck(us))
+          return { DRAW, STALEMATE, ply };
+        return { us == WHITE ? BLACK_WINS : WHITE_WINS, MATE, ply };
+      }
+      if (std::count(history.begin(), history.end(), board.hashKey) >= 3)
+        return { DRAW, REPETITION, ply };
+      if (halfmoves >= 100)
+        return { DRAW, FIFTY_MOVES, ply };
+      switch (Bitbases::probe(board)) {
+        case Bitbases::DRAW: return { DRAW, BITBASE, ply };
+        case Bitbases::WIN:  return { us == WHITE ? WHITE_WINS : BLACK_WINS, BITBASE, ply };
+        case Bitbases::LOSS: return { us == WHITE ? BLACK_WINS : WHITE_WINS, BITBASE, ply };
+        default: break;
+      }
+      if (ply >= maxPlies)
+        return { DRAW, MAX_PLIES, ply };
+
+      const Engine& e = *engines[us];
+      Search::Limits limits = e.limits;
+      if (e.clock) {
+        limits.time[us] = clock[us];
+        limits.inc[us]  = e.limits.inc[us];
+      }
+      players[us]->tt->newSearch();
+      Search::Result r = Search::searchPosition(*players[us]->td, board, limits);
+      if (e.clock) {
+        clock[us] -= r.timeMs;
+        if (clock[us] < 0)
+          return { us == WHITE ? BLACK_WINS : WHITE_WINS, TIME_FORFEIT, ply };
+        clock[us] += e.limits.inc[us];
+      }
+
+      // Adjudication on the mover's score, turned into White's view
+      int white = us == WHITE ? r.score : -r.score;
+      resignCount[WHITE] = white <= -RESIGN_SCORE ? resignCount[WHITE] + 1 : 0;
+      resignCount[BLACK] = white >=  RESIGN_SCORE ? resignCount[BLACK] + 1 : 0;
+      drawCount          = ply >= DRAW_FROM_PLY && std::abs(white) <= DRAW_SCORE ? drawCount + 1 : 0;
+      if (resignCount[WHITE] >= RESIGN_PLIES)
+        return { BLACK_WINS, RESIGNATION, ply };
+      if (resignCount[BLACK] >= RESIGN_PLIES)
+        return { WHITE_WINS, RESIGNATION, ply };
+      if (drawCount >= DRAW_PLIES)
+        return { DRAW, DRAW_ADJUDICATION, ply };
+
+      Move m = r.bestMove;
+      bool irreversible = m.isCapture() || typeOf(board.pieceOn(m.from())) == PAWN;
+      board.makeMove(m);
+      halfmoves = irreversible ? 0 : halfmoves + 1;
+      if (irreversible)
+        history.clear();
+      history.push_back(board.hashKey);
+    }
+  }
+
+  // Win/draw/loss counts from A's side, with the Elo estimate and the SPRT log-likelihood ratio
+  // under the normal approximation to the per-game score
+  struct Tally {
+    int wins = 0, draws = 0, losses = 0;
+    int reasons[REASON_COUNT] = {};
+
+    int    games() const { return wins + draws + losses; }
+    double score() const { return games() ? (wins + 0.5 * draws) / games() : 0.5; }
+    double variance() const {
+      double s = score(), n = games();
+      if (!n) return 0;
+      return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / n;
+    }
+  };
+
+  static double eloFromScore(double s) {
+    s = std::clamp(s, 1e-6, 1 - 1e-6);
+    return s == 0.5 ? 0.0 : -400.0 * std::log10(1.0 / s - 1.0);
+  }
+  static double scoreFromElo(double elo) {
+    return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+  }
+
+  // Half-width of the 95% confidence interval, in Elo
+  static double eloMargin(const Tally& t) {
+    if (!t.games())
+      return 0;
+    double se = std::sqrt(t.variance() / t.games());
+    return (eloFromScore(t.score() + 1.96 * se) - eloFromScore(t.score() - 1.96 * se)) / 2;
+  }
+
+  static double llr(const Tally& t, double elo0, double elo1) {
+    double var = t.variance();
+    if (var <= 0)
+      return 0;
+    double s0 = scoreFromElo(elo0), s1 = scoreFromElo(elo1);
+    return t.games() * (s1 - s0) * (2 * t.score() - s0 - s1) / (2 * var);
+  }
+
+  int run(int argc, char** argv) {
+    int         games       = DEFAULT_GAMES;
+    int         concurrency = int(std::max(1u, std::thread::hardware_concurrency()));
+    int         plies       = DEFAULT_PLIES;
+    int         maxPlies    = DEFAULT_MAX_PLIES;
+    int         report      = DEFAULT_REPORT;
+    size_t      hashMB      = DEFAULT_HASH;
+    uint64_t    seed        = 1;
+    std::string specA, specB, openingsPath;
+    bool        sprt  = false;
+    double      elo0  = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+    Engine      common;
+    bool        hasLimits = false;
+    try {
+      for (int i = 0; i < argc; ++i) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if      (a == "--games"       && hasValue) games        = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--concurrency" && hasValue) concurrency  = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--a"           && hasValue) specA        = argv[++i];
+        else if (a == "--b"           && hasValue) specB        = argv[++i];
+        else if (a == "--openings"    && hasValue) openingsPath = argv[++i];
+        else if (a == "--plies"       && hasValue) plies        = std::max(0, std::atoi(argv[++i]));
+        else if (a == "--maxplies"    && hasValue) maxPlies     = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--hash"        && hasValue) hashMB       = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--seed"        && hasValue) seed         = std::strtoull(argv[++i], nullptr, 10);
+        else if (a == "--report"      && hasValue) report       = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--alpha"       && hasValue) alpha        = std::atof(argv[++i]);
+        else if (a == "--beta"        && hasValue) beta         = std::atof(argv[++i]);
+        else if (a == "--sprt" && i + 2 < argc) {
+          elo0 = std::atof(argv[++i]);
+          elo1 = std::atof(argv[++i]);
+          sprt = true;
+        }
+        else if (a == "--nodes"    && hasValue) { common.limits.nodes    = std::strtoull(argv[++i], nullptr, 10); hasLimits = true; }
+        else if (a == "--depth"    && hasValue) { common.limits.depth    = std::atoi(argv[++i]);                  hasLimits = true; }
+        else if (a == "--movetime" && hasValue) { common.limits.movetime = std::atoll(argv[++i]);                 hasLimits = true; }
+        else if (a == "--tc"       && hasValue) { parseTimeControl(argv[++i], common.limits); common.clock = true; hasLimits = true; }
+        else {
+          std::cerr << "usage: chess-bot match [--games N] [--concurrency N] [--a SPEC] [--b SPEC]"
+                       " [--openings FILE] [--plies N] [--nodes N | --depth D | --movetime MS | --tc BASE+INC]"
+                       " [--hash MB] [--maxplies N] [--sprt ELO0 ELO1] [--alpha A] [--beta B] [--seed S]"
+                       " [--report N]\n";
+          return 2;
+        }
+      }
+      if (!hasLimits)
+        common.limits.nodes = DEFAULT_NODES;
+      if (sprt && (elo1 <= elo0 || alpha <= 0 || alpha >= 1 || beta <= 0 || beta >= 1))
+        throw std::invalid_argument("--sprt needs ELO0 < ELO1 and 0 < alpha, beta < 1");
+    } catch (const std::exception& e) {
+      std::cerr << "match: " << e.what() << "\n";
+      return 2;
+    }
+
+    Engine engines[2] = { common, common };    // A, B
+    std::vector<Board> openings;
+    try {
+      parseSpec(specA, engines[0]);
+      parseSpec(specB, engines[1]);
+      if (!openingsPath.empty())
+        openings = readOpenings(openingsPath);
+    } catch (const std::exception& e) {
+      std::cerr << "match: " << e.what() << "\n";
+      return 2;
+    }
+
+    const double lower = std::log(beta / (1 - alpha)), upper = std::log((1 - beta) / alpha);
+    std::cout << "A: " << (specA.empty() ? "default" : specA) << "\n"
+              << "B: " << (specB.empty() ? "default" : specB) << "\n"
+              << games << " games, " << concurrency << " at a time, "
+              << (openings.empty() ? std::to_string(plies) + " random opening plies"
+                                   : std::to_string(openings.size()) + " openings from " + openingsPath) << "\n";
+    if (sprt)
+      std::cout << "SPRT elo0 " << elo0 << " elo1 " << elo1 << " alpha " << alpha << " beta " << beta
+                << " bounds [" << std::fixed << std::setprecision(2) << lower << ", " << upper << "]\n";
+    std::cout << std::defaultfloat;
+
+    Tally             tally;
+    std::mutex        tallyMutex;
+    std::atomic<int>  nextGame { 0 };
+    std::atomic<bool> stop     { false };
+    std::string       verdict;
+    auto start = std::chrono::steady_clock::now();
+
+    auto status = [&](std::ostream& os) {
+      os << "Games " << tally.games() << ": +" << tally.wins << " -" << tally.losses << " =" << tally.draws
+         << std::fixed << std::setprecision(1)
+         << "  Elo " << eloFromScore(tally.score()) << " +/- " << eloMargin(tally);
+      if (sprt)
+        os << std::setprecision(2) << "  LLR " << llr(tally, elo0, elo1);
+      os << std::defaultfloat << "\n";
+    };
+
+    // Game g plays opening g/2, A with White on even g; each worker keeps its players' memory
+    std::vector<std::thread> workers;
+    for (int w = 0; w < std::min(concurrency, games); ++w) {
+      workers.emplace_back([&] {
+        Player a(hashMB), b(hashMB);
+        int g;
+        while (!stop.load() && (g = nextGame.fetch_add(1)) < games) {
+          int pair = g / 2;
+          Board opening = openings.empty() ? randomOpening(plies, seed * 1000003 + uint64_t(pair))
+                                           : openings[pair % openings.size()];
+          bool aWhite = g % 2 == 0;
+          const Engine* byColor[2] = { &engines[aWhite ? 0 : 1], &engines[aWhite ? 1 : 0] };
+          Player*       players[2] = { aWhite ? &a : &b, aWhite ? &b : &a };
+          GameResult r = playGame(opening, byColor, players, maxPlies);
+
+          std::lock_guard<std::mutex> lock(tallyMutex);
+          if (r.result == DRAW)                          tally.draws++;
+          else if ((r.result == WHITE_WINS) == aWhite)   tally.wins++;
+          else                                           tally.losses++;
+          tally.reasons[r.reason]++;
+          if (tally.games() % report == 0)
+            status(std::cout);
+          if (sprt && verdict.empty()) {
+            double l = llr(tally, elo0, elo1);
+            if (l >= upper)      verdict = "H1 accepted: A is at least " + std::to_string(int(elo1)) + " Elo better";
+            else if (l <= lower) verdict = "H0 accepted: A is not " + std::to_string(int(elo1)) + " Elo better";
+            if (!verdict.empty())
+              stop = true;
+          }
+        }
+      });
+    }
+    for (auto& t : workers) t.join();
+
+    int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start).count();
+    std::cout << "\n===========================\n";
+    status(std::cout);
+    std::cout << "Score          : " << std::fixed << std::setprecision(1) << 100 * tally.score() << "%\n"
+              << std::defaultfloat;
+    if (sprt)
+      std::cout << "SPRT           : " << (verdict.empty() ? "no decision yet" : verdict) << "\n";
+    std::cout << "Endings        :";
+    for (int i = 0; i < REASON_COUNT; ++i)
+      if (tally.reasons[i])
+        std::cout << ' ' << REASON_NAMES[i] << ' ' << tally.reasons[i];
+    std::cout << "\nTime (ms)      : " << ms << "\n";
+    return 0;
+  }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace Match {
+  // Command-line entry point for the "match" mode:
+  //   match [--games N] [--concurrency N] [--a SPEC] [--b SPEC] [--openings FILE] [--plies N]
+  //         [--nodes N | --depth D | --movetime MS | --tc BASE+INC] [--hash MB] [--maxplies N]
+  //         [--sprt ELO0 ELO1] [--alpha A] [--beta B] [--seed S] [--report N]
+  // Plays engine A against engine B in this process, many games at once. Each engine is a set of
+  // Search::Params plus search limits, given as a comma-separated SPEC of key=value pairs:
+  //   nnue, rfp, nullmove, futility, lmr (0/1), rfpmargin, aspiration (cp),
+  //   nodes, depth, movetime (ms), tc (BASE+INC, ms)
+  // Every opening (FEN/EPD lines from FILE, or --plies random moves from the start position) is
+  // played twice with colors swapped. Games end on the rules (mate, stalemate, threefold
+  // repetition, 50 moves, bitbase-known results), on the clock, or by adjudication: both engines
+  // agree one side is far ahead, or the score stays near zero late in the game.
+  // Reports A's Elo with a 95% error margin and, with --sprt, the log-likelihood ratio of
+  // H1 (ELO1) against H0 (ELO0), stopping once it crosses a bound. Returns the process exit code.
+  int run(int argc, char** argv);
+}
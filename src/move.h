@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+
+// Move flags, stored in the top 4 bits of a Move.
+// Bit 2 marks captures, bit 3 marks promotions (low 2 bits then pick N/B/R/Q).
+enum MoveFlag : uint16_t {
+    QUIET           = 0,
+    DOUBLE_PUSH     = 1,
+    KING_CASTLE     = 2,
+    QUEEN_CASTLE    = 3,
+    CAPTURE         = 4,
+    EN_PASSANT      = 5,
+    PROMO_KNIGHT    = 8,
+    PROMO_BISHOP    = 9,
+    PROMO_ROOK      = 10,
+    PROMO_QUEEN     = 11,
+    PROMO_KNIGHT_CAPTURE = 12,
+    PROMO_BISHOP_CAPTURE = 13,
+    PROMO_ROOK_CAPTURE   = 14,
+    PROMO_QUEEN_CAPTURE  = 15
+};
+
+// Packed 16-bit move: bits 0-5 from, bits 6-11 to, bits 12-15 flags.
+// A zero value is the null move (a1a1 can never be generated).
+struct Move {
+    uint16_t data = 0;
+
+    constexpr Move() = default;
+    constexpr Move(int from, int to, int flags = QUIET)
+        : data(uint16_t(from | (to << 6) | (flags << 12))) {}
+
+    constexpr int  from()        const { return data & 63; }
+    constexpr int  to()          const { return (data >> 6) & 63; }
+    constexpr int  flags()       const { return data >> 12; }
+    constexpr bool isCapture()   const { return flags() & CAPTURE; }
+    constexpr bool isPromotion() const { return flags() & PROMO_KNIGHT; }
+
+    // Promotion piece as an uppercase char ('N','B','R','Q'); only valid if isPromotion()
+    constexpr char promotion()   const { return "NBRQ"[flags() & 3]; }
+
+    constexpr explicit operator bool() const { return data != 0; }
+    constexpr bool operator==(const Move&) const = default;
+};
+
+// Fixed-capacity move list that lives on the stack (218 is the most legal moves in any position)
+struct MoveList {
+    static constexpr int MAX_MOVES = 256;
+
+    std::array<Move, MAX_MOVES> moves;
+    int count = 0;
+
+    void add(Move m)              { moves[count++] = m; }
+    void clear()                  { count = 0; }
+    int  size()  const            { return count; }
+    bool empty() const            { return count == 0; }
+
+    Move&       operator[](int i)       { return moves[i]; }
+    const Move& operator[](int i) const { return moves[i]; }
+
+    Move*       begin()       { return moves.data(); }
+    Move*       end()         { return moves.data() + count; }
+    const Move* begin() const { return moves.data(); }
+    const Move* end()   const { return moves.data() + count; }
+};
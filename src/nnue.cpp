@@ -0,0 +1,262 @@
+#include "nnue.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace NNUE {
+
+  bool netLoaded = false;
+
+  constexpr uint32_t VERSION      = 1;
+  constexpr int      HEADER_SIZE  = 24;
+  constexpr int      WEIGHT_SHIFT = 6;      // hidden layer sums are scaled by 2^6
+  constexpr int      OUTPUT_SCALE = 16;     // final sum per centipawn
+  constexpr int      MAX_SCORE    = 20000;  // keep clear of the search's mate scores
+
+  constexpr size_t FILE_SIZE = HEADER_SIZE
+                             + sizeof(int16_t) * (L1 + size_t(INPUTS) * L1)
+                             + sizeof(int32_t) * L2 + sizeof(int8_t) * L2 * 2 * L1
+                             + sizeof(int32_t) * L3 + sizeof(int8_t) * L3 * L2
+                             + sizeof(int32_t)      + sizeof(int8_t) * L3;
+
+  // Views into the mapped file
+  struct Network {
+    const int16_t* ftBias;
+    const int16_t* ftWeights;
+    const int32_t* l1Bias;
+    const int8_t*  l1Weights;
+    const int32_t* l2Bias;
+    const int8_t*  l2Weights;
+    const int32_t* outBias;
+    const int8_t*  outWeights;
+  };
+  static Network net;
+  static void*   mapping     = nullptr;
+  static size_t  mappingSize = 0;
+
+  // Feature of piece p on sq as seen by 'perspective' with its king on kingSq.
+  // Black's view is flipped vertically; own pieces are kinds 0-4, enemy pieces 5-9.
+  static int featureIndex(Color perspective, int kingSq, Piece p, int sq) {
+    int flip = perspective == WHITE ? 0 : 56;
+    int kind = (colorOf(p) == perspective ? 0 : 5) + typeOf(p);
+    return ((kingSq ^ flip) * 10 + kind) * 64 + (sq ^ flip);
+  }
+
+  // out = in + the weight rows of 'added' - the weight rows of 'removed'
+  static void updateRows(const int16_t* in, int16_t* out,
+                         const int* added, int nAdded, const int* removed, int nRemoved) {
+#if defined(__AVX2__)
+    for (int i = 0; i < L1; i += 16) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(in + i));
+      for (int a = 0; a < nAdded; ++a)
+        v = _mm256_add_epi16(v, _mm256_loadu_si256((const __m256i*)(net.ftWeights + size_t(added[a]) * L1 + i)));
+      for (int r = 0; r < nRemoved; ++r)
+        v = _mm256_sub_epi16(v, _mm256_loadu_si256((const __m256i*)(net.ftWeights + size_t(removed[r]) * L1 + i)));
+      _mm256_store_si256((__m256i*)(out + i), v);
+    }
+#else
+    for (int i = 0; i < L1; ++i) {
+      int16_t v = in[i];
+      for (int a = 0; a < nAdded; ++a)   v += net.ftWeights[size_t(added[a]) * L1 + i];
+      for (int r = 0; r < nRemoved; ++r) v -= net.ftWeights[size_t(removed[r]) * L1 + i];
+      out[i] = v;
+    }
+#endif
+  }
+
+  // One perspective from scratch: bias plus the rows of every non-king piece
+  static void refresh(const Board& board, Color perspective, int16_t* out) {
+    int kingSq = __builtin_ctzll(board.getPieces(perspective, KING));
+    uint64_t bb = board.getAllPieces() & ~(board.getPieces(WHITE, KING) | board.getPieces(BLACK, KING));
+    int features[64], n = 0;
+    while (bb) {
+      int sq = __builtin_ctzll(bb);
+      bb &= bb - 1;
+      features[n++] = featureIndex(perspective, kingSq, board.pieceOn(sq), sq);
+    }
+    updateRows(net.ftBias, out, features, n, nullptr, 0);
+  }
+
+  void AccumulatorStack::reset(const Board& board) {
+    top = 0;
+    refresh(board, WHITE, stack[0].v[WHITE]);
+    refresh(board, BLACK, stack[0].v[BLACK]);
+  }
+
+  // Derive the changed (piece, square) pairs from the move record; kings are not features, and a
+  // king move refreshes its own side's perspective instead
+  void AccumulatorStack::push(const Board& board, const Board::MoveRecord& rec) {
+    const Accumulator& prev = stack[top];
+    Accumulator&       next = stack[++top];
+
+    Move  m      = rec.move;
+    Color us     = ~board.sideToMove;
+    int   from   = m.from(), to = m.to();
+    Piece placed = board.pieceOn(to);
+    Piece moved  = m.isPromotion() ? makePiece(us, PAWN) : placed;
+
+    Piece addPiece[2], removePiece[3];
+    int   addSq[2], removeSq[3], nAdd = 0, nRemove = 0;
+    if (typeOf(moved) != KING) {
+      removePiece[nRemove] = moved;  removeSq[nRemove++] = from;
+      addPiece[nAdd]       = placed; addSq[nAdd++]       = to;
+    }
+    if (rec.captured != NO_PIECE) {
+      removePiece[nRemove] = rec.captured;
+      removeSq[nRemove++]  = m.flags() == EN_PASSANT ? to ^ 8 : to;
+    }
+    if (m.flags() == KING_CASTLE || m.flags() == QUEEN_CASTLE) {
+      Piece rook = makePiece(us, ROOK);
+      removePiece[nRemove] = rook; removeSq[nRemove++] = m.flags() == KING_CASTLE ? to + 1 : to - 2;
+      addPiece[nAdd]       = rook; addSq[nAdd++]       = m.flags() == KING_CASTLE ? to - 1 : to + 1;
+    }
+
+    for (Color c : { WHITE, BLACK }) {
+      if (typeOf(moved) == KING && c == us) {
+        refresh(board, c, next.v[c]);
+        continue;
+      }
+      int kingSq = __builtin_ctzll(board.getPieces(c, KING));
+      int added[2], removed[3];
+      for (int i = 0; i < nAdd; ++i)    added[i]   = featureIndex(c, kingSq, addPiece[i], addSq[i]);
+      for (int i = 0; i < nRemove; ++i) removed[i] = featureIndex(c, kingSq, removePiece[i], removeSq[i]);
+      updateRows(prev.v[c], next.v[c], added, nAdd, removed, nRemove);
+    }
+  }
+
+  // Clipped ReLU of the accumulator into 0..127 bytes
+  static void transform(const int16_t* acc, uint8_t* out) {
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    for (int i = 0; i < L1; i += 32) {
+      __m256i a = _mm256_load_si256((const __m256i*)(acc + i));
+      __m256i b = _mm256_load_si256((const __m256i*)(acc + i + 16));
+      __m256i packed = _mm256_max_epi8(_mm256_packs_epi16(a, b), zero);   // saturates at 127
+      _mm256_store_si256((__m256i*)(out + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+#else
+    for (int i = 0; i < L1; ++i)
+      out[i] = uint8_t(std::clamp<int>(acc[i], 0, 127));
+#endif
+  }
+
+  // Dot product of n (a multiple of 32) unsigned activations with signed weights
+  static int dot(const uint8_t* in, const int8_t* w, int n) {
+#if defined(__AVX2__)
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < n; i += 32) {
+      __m256i products = _mm256_maddubs_epi16(_mm256_load_si256((const __m256i*)(in + i)),
+                                              _mm256_loadu_si256((const __m256i*)(w + i)));
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return _mm_cvtsi128_si32(s);
+#else
+    int sum = 0;
+    for (int i = 0; i < n; ++i)
+      sum += in[i] * w[i];
+    return sum;
+#endif
+  }
+
+  static void affineRelu(const uint8_t* in, int inDims, const int8_t* weights, const int32_t* bias,
+                         int outDims, uint8_t* out) {
+    for (int o = 0; o < outDims; ++o) {
+      int sum = bias[o] + dot(in, weights + o * inDims, inDims);
+      out[o] = uint8_t(std::clamp(sum >> WEIGHT_SHIFT, 0, 127));
+    }
+  }
+
+  int evaluate(const Board& board) {
+    Accumulator scratch;
+    const Accumulator* acc = &scratch;
+    if (board.nnue.stack) {
+      acc = &board.nnue.stack->current();
+    } else {
+      refresh(board, WHITE, scratch.v[WHITE]);
+      refresh(board, BLACK, scratch.v[BLACK]);
+    }
+#ifdef EVAL_CHECK
+    if (board.nnue.stack) {
+      refresh(board, WHITE, scratch.v[WHITE]);
+      refresh(board, BLACK, scratch.v[BLACK]);
+      if (std::memcmp(scratch.v, acc->v, sizeof(scratch.v)) != 0) {
+        std::fprintf(stderr, "NNUE::evaluate: incremental accumulator differs from a refresh\n");
+        std::abort();
+      }
+    }
+#endif
+
+    alignas(32) uint8_t input[2 * L1], hidden1[L2], hidden2[L3];
+    Color us = board.sideToMove;
+    transform(acc->v[us],  input);
+    transform(acc->v[~us], input + L1);
+    affineRelu(input,   2 * L1, net.l1Weights, net.l1Bias, L2, hidden1);
+    affineRelu(hidden1, L2,     net.l2Weights, net.l2Bias, L3, hidden2);
+    int out = *net.outBias + dot(hidden2, net.outWeights, L3);
+    return std::clamp(out / OUTPUT_SCALE, -MAX_SCORE, MAX_SCORE);
+  }
+
+  bool load(const std::string& path, std::string& error) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      error = "cannot open " + path;
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) != FILE_SIZE) {
+      close(fd);
+      error = path + ": expected " + std::to_string(FILE_SIZE) + " bytes";
+      return false;
+    }
+    void* p = mmap(nullptr, FILE_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+      error = "cannot map " + path;
+      return false;
+    }
+
+    const char* bytes = static_cast<const char*>(p);
+    uint32_t header[5];
+    std::memcpy(header, bytes + 4, sizeof(header));
+    if (std::memcmp(bytes, "CBNN", 4) != 0 || header[0] != VERSION || header[1] != INPUTS
+        || header[2] != L1 || header[3] != L2 || header[4] != L3) {
+      munmap(p, FILE_SIZE);
+      error = path + ": not a version 1 HalfKP 2x256-32-32-1 net";
+      return false;
+    }
+    madvise(p, FILE_SIZE, MADV_WILLNEED);
+
+    const char* at = bytes + HEADER_SIZE;
+    auto take = [&](auto*& field, size_t count) {
+      field = reinterpret_cast<std::remove_reference_t<decltype(field)>>(at);
+      at += count * sizeof(*field);
+    };
+    take(net.ftBias,     L1);
+    take(net.ftWeights,  size_t(INPUTS) * L1);
+    take(net.l1Bias,     L2);
+    take(net.l1Weights,  L2 * 2 * L1);
+    take(net.l2Bias,     L3);
+    take(net.l2Weights,  L3 * L2);
+    take(net.outBias,    1);
+    take(net.outWeights, L3);
+
+    if (mapping)
+      munmap(mapping, mappingSize);
+    mapping     = p;
+    mappingSize = FILE_SIZE;
+    netLoaded   = true;
+    return true;
+  }
+}
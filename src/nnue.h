@@ -0,0 +1,59 @@
+#pragma once
+
+#include "board.h"
+#include <cstdint>
+#include <string>
+
+// Efficiently updatable neural network evaluation (HalfKP-style, 2x256-32-32-1).
+//
+// Input features, per perspective: (own king square, non-king piece, piece square) with the
+// board flipped for Black, so each side sees itself moving up the board. Only pieces that move
+// touch the feature transformer, so its output (the accumulator) is updated incrementally in
+// Board::makeMove and popped in unmakeMove; a king move recomputes its own perspective.
+//
+// Net file layout (little endian, no padding):
+//   char[4] "CBNN", uint32 version = 1, uint32 inputs = 40960, uint32 L1 = 256, uint32 L2 = 32, uint32 L3 = 32
+//   int16 ftBias[L1]    int16 ftWeights[inputs][L1]
+//   int32 l1Bias[L2]    int8  l1Weights[L2][2 * L1]
+//   int32 l2Bias[L3]    int8  l2Weights[L3][L2]
+//   int32 outBias       int8  outWeights[L3]
+// Hidden layers are clipped ReLUs on (sum >> 6) into 0..127; the final sum / 16 is centipawns
+// for the side to move.
+namespace NNUE {
+
+  constexpr int INPUTS = 64 * 10 * 64;
+  constexpr int L1     = 256;
+  constexpr int L2     = 32;
+  constexpr int L3     = 32;
+
+  // Feature transformer output for both perspectives, indexed by Color
+  struct alignas(32) Accumulator {
+    int16_t v[2][L1];
+  };
+
+  // One accumulator per ply from the root, owned by a search thread and attached to its Board
+  class AccumulatorStack {
+  public:
+    static constexpr int CAPACITY = 128;
+
+    void reset(const Board& board);                            // recompute the root entry
+    void push(const Board& board, const Board::MoveRecord& rec); // after makeMove
+    void pop() { --top; }                                      // before unmakeMove
+    const Accumulator& current() const { return stack[top]; }
+
+  private:
+    Accumulator stack[CAPACITY];
+    int         top = 0;
+  };
+
+  // Map a net file into memory and use it from now on; replaces any previous net.
+  // Returns false and leaves the previous state untouched on error.
+  bool load(const std::string& path, std::string& error);
+
+  extern bool netLoaded;
+  inline bool isLoaded() { return netLoaded; }
+
+  // Score from the side to move's view. Uses the board's attached accumulators, or computes
+  // them from scratch if none are attached.
+  int evaluate(const Board& board);
+}
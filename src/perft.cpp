@@ -0,0 +1,202 @@
+// Perft / divide harness for benchmarking and validating move generation
+#include "perft.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Perft {
+
+  // Optional shared hash of subtree counts. Same lockless trick as the search TT:
+  // the check word is key ^ count, so a torn write simply fails verification.
+  struct HashEntry {
+    std::atomic<uint64_t> check { 0 };
+    std::atomic<uint64_t> count { 0 };
+  };
+  static std::unique_ptr<HashEntry[]> hashTable;
+  static size_t hashEntries = 0;
+
+  // Fold the remaining depth into the position key so one table serves every depth
+  static uint64_t hashKeyFor(const Board& board, int depth) {
+    return board.hashKey ^ (uint64_t(depth) * 0x9E3779B97F4A7C15ULL);
+  }
+
+  static uint64_t perftRec(Board& board, int depth) {
+    MoveList moves;
+    board.generateAllLegalMoves(moves);
+    if (depth == 1)
+      return moves.size();
+
+    uint64_t key = 0;
+    HashEntry* slot = nullptr;
+    if (hashEntries) {
+      key  = hashKeyFor(board, depth);
+      slot = &hashTable[key % hashEntries];
+      uint64_t c = slot->count.load(std::memory_order_relaxed);
+      if ((slot->check.load(std::memory_order_relaxed) ^ c) == key)
+        return c;
+    }
+
+    uint64_t nodes = 0;
+    for (Move m : moves) {
+      Board::MoveRecord rec = board.makeMove(m);
+      nodes += perftRec(board, depth - 1);
+      board.unmakeMove(rec);
+    }
+
+    if (slot) {
+      slot->count.store(nodes,       std::memory_order_relaxed);
+      slot->check.store(key ^ nodes, std::memory_order_relaxed);
+    }
+    return nodes;
+  }
+
+  uint64_t perft(Board& board, int depth) {
+    return depth <= 0 ? 1 : perftRec(board, depth);
+  }
+
+  // Root moves are handed out to threads through a shared counter; each thread works on its own board copy
+  static uint64_t divide(const Board& board, int depth, int threads, std::vector<uint64_t>& counts, MoveList& rootMoves) {
+    Board root = board;
+    root.generateAllLegalMoves(rootMoves);
+    counts.assign(rootMoves.size(), 0);
+    if (depth <= 1) {
+      std::fill(counts.begin(), counts.end(), 1);
+      return rootMoves.size();
+    }
+
+    std::atomic<int> next { 0 };
+    auto worker = [&]() {
+      Board b = board;
+      for (int i; (i = next.fetch_add(1)) < rootMoves.size(); ) {
+        Board::MoveRecord rec = b.makeMove(rootMoves[i]);
+        counts[i] = perft(b, depth - 1);
+        b.unmakeMove(rec);
+      }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+
+    uint64_t total = 0;
+    for (uint64_t c : counts) total += c;
+    return total;
+  }
+
+  // Reference counts from the Chess Programming Wiki "Perft Results" page
+  struct SuiteEntry {
+    const char* name;
+    const char* fen;
+    int         depth;
+    uint64_t    nodes;
+  };
+  static const SuiteEntry SUITE[] = {
+    { "startpos",   "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",                 6, 119060324ULL },
+    { "kiwipete",   "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",     5, 193690690ULL },
+    { "position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",                                7, 178633661ULL },
+    { "position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",         5,  15833292ULL },
+    { "position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",                5,  89941194ULL },
+    { "position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5, 164075551ULL },
+  };
+
+  static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  static void printRate(uint64_t nodes, double secs) {
+    std::cout << "Nodes: " << nodes << "\n"
+              << "Time:  " << secs << " s\n"
+              << "NPS:   " << uint64_t(nodes / std::max(secs, 1e-9)) << "\n";
+  }
+
+  static int runSuite(int threads) {
+    std::vector<uint64_t> counts;
+    MoveList rootMoves;
+    uint64_t totalNodes = 0;
+    int      failures   = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const SuiteEntry& e : SUITE) {
+      Board board;
+      board.setFen(e.fen);
+      auto t = std::chrono::steady_clock::now();
+      uint64_t n = divide(board, e.depth, threads, counts, rootMoves);
+      double secs = secondsSince(t);
+      bool ok = (n == e.nodes);
+      failures += !ok;
+      totalNodes += n;
+      std::cout << (ok ? "OK   " : "FAIL ") << e.name << " depth " << e.depth
+                << ": " << n << (ok ? "" : " (expected " + std::to_string(e.nodes) + ")")
+                << "  " << uint64_t(n / std::max(secs, 1e-9)) << " nps\n";
+    }
+
+    std::cout << "\n";
+    printRate(totalNodes, secondsSince(start));
+    std::cout << (failures ? std::to_string(failures) + " position(s) FAILED\n" : "All positions match\n");
+    return failures ? 1 : 0;
+  }
+
+  int run(int argc, char** argv) {
+    int threads = 1;
+    size_t hashMB = 0;
+    std::vector<std::string> args;
+    for (int i = 0; i < argc; ++i) {
+      std::string a = argv[i];
+      if ((a == "--threads" || a == "--hash") && i + 1 < argc) {
+        if (a == "--threads") threads = std::max(1, std::atoi(argv[++i]));
+        else                  hashMB  = std::strtoull(argv[++i], nullptr, 10);
+      } else {
+        args.push_back(a);
+      }
+    }
+
+    if (hashMB) {
+      hashEntries = (hashMB << 20) / sizeof(HashEntry);
+      hashTable   = std::make_unique<HashEntry[]>(hashEntries);
+    }
+
+    if (args.empty()) {
+      std::cerr << "usage: chess-bot perft <depth> [fen] [--threads N] [--hash MB]\n"
+                << "       chess-bot perft suite [--threads N] [--hash MB]\n";
+      return 2;
+    }
+    if (args[0] == "suite")
+      return runSuite(threads);
+
+    int depth = std::atoi(args[0].c_str());
+    if (depth < 1) {
+      std::cerr << "perft: depth must be at least 1\n";
+      return 2;
+    }
+    std::string fen;
+    for (size_t i = 1; i < args.size(); ++i) fen += (i > 1 ? " " : "") + args[i];
+
+    Board board;
+    try {
+      if (!fen.empty()) board.setFen(fen);
+    } catch (const std::invalid_argument& e) {
+      std::cerr << e.what() << "\n";
+      return 2;
+    }
+
+    std::vector<uint64_t> counts;
+    MoveList rootMoves;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t total = divide(board, depth, threads, counts, rootMoves);
+    double secs = secondsSince(start);
+
+    for (int i = 0; i < rootMoves.size(); ++i)
+      std::cout << Board::moveToString(rootMoves[i]) << ": " << counts[i] << "\n";
+    std::cout << "\n";
+    printRate(total, secs);
+    return 0;
+  }
+
+} // namespace Perft
@@ -0,0 +1,14 @@
+#pragma once
+#include "board.h"
+#include <cstdint>
+
+namespace Perft {
+  // Leaf count of the legal move tree below 'board' (bulk-counted at the last ply)
+  uint64_t perft(Board& board, int depth);
+
+  // Command-line entry point for the "perft" mode:
+  //   perft <depth> [fen] [--threads N] [--hash MB]   divide breakdown, total and nodes/second
+  //   perft suite [--threads N] [--hash MB]           standard positions checked against reference counts
+  // Returns the process exit code.
+  int run(int argc, char** argv);
+}
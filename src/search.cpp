@@ -1,78 +1,1056 @@
 #include "search.h"
+#include "bitbase.h"
+#include "cache.h"
 #include "eval.h"
-#include <limits>
+#include "tt.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
 #include <cstdlib>
 #include <iostream>
+#include <sstream>
+#include <utility>
 
 
 namespace Search {
 
-  static void sortMoves(std::vector<std::pair<int,int>>& moves) {
-    // Unused for now, but when visuals are implemented this will be useful
+  // Per-thread state, allocated once by setThreads. threads[0] runs on the caller.
+  static std::vector<std::unique_ptr<ThreadData>> threads;
+  static Stats stats;
+  static std::vector<IterationStats> iterations;
+  static std::vector<Move> pvLine;
+
+  const Stats&                       lastStats()      { return stats; }
+  const std::vector<IterationStats>& lastIterations() { return iterations; }
+  const std::vector<Move>&           lastPV()         { return pvLine; }
+
+  static std::ostream* statsOut = nullptr;
+  static std::mutex    statsOutMutex;
+
+  void dumpStats(std::ostream* out) { statsOut = out; }
+
+  Stats& Stats::operator+=(const Stats& o) {
+    nodes            += o.nodes;
+    qnodes           += o.qnodes;
+    ttProbes         += o.ttProbes;
+    ttHits           += o.ttHits;
+    ttCutoffs        += o.ttCutoffs;
+    hashMoveCutoffs  += o.hashMoveCutoffs;
+    betaCutoffs      += o.betaCutoffs;
+    firstMoveCutoffs += o.firstMoveCutoffs;
+    nullMoveCutoffs  += o.nullMoveCutoffs;
+    futilityPrunes   += o.futilityPrunes;
+    lmrResearches    += o.lmrResearches;
+    movePickers      += o.movePickers;
+    hashMoveStage    += o.hashMoveStage;
+    captureStage     += o.captureStage;
+    killerStage      += o.killerStage;
+    quietStage       += o.quietStage;
+    pawnProbes       += o.pawnProbes;
+    pawnHits         += o.pawnHits;
+    bitbaseProbes    += o.bitbaseProbes;
+    bitbaseHits      += o.bitbaseHits;
+    return *this;
+  }
+
+  // Geometric mean growth of the node count per extra ply, from the first to the last iteration
+  static double branchingFactor(const std::vector<IterationStats>& its) {
+    if (its.size() < 2 || its.back().depth <= its.front().depth || its.front().nodes == 0)
+      return 0;
+    return std::pow(double(its.back().nodes) / double(its.front().nodes),
+                    1.0 / double(its.back().depth - its.front().depth));
   }
 
-  int alphaBeta(Board& board, int depth, int α, int β) {
-    if (depth == 0) 
-        return Eval::evaluate(board);
+  static double ratio(uint64_t part, uint64_t whole) {
+    return whole ? double(part) / double(whole) : 0.0;
+  }
 
-    auto moves = board.generateAllLegalMoves();
-    if (moves.empty())
-        return board.isKingInCheck(board.sideToMove)
-               ? -99999
-               : 0;
+  static std::string toJson(uint64_t key, const Stats& s, const std::vector<IterationStats>& its) {
+    std::ostringstream os;
+    os << std::setprecision(4)
+       << "{\"key\":\"" << std::hex << std::setw(16) << std::setfill('0') << key << std::dec << "\""
+       << ",\"nodes\":"                   << s.nodes
+       << ",\"qnodes\":"                  << s.qnodes
+       << ",\"depth\":"                   << s.depth
+       << ",\"time_ms\":"                 << s.timeMs
+       << ",\"ebf\":"                     << s.ebf
+       << ",\"tt_probes\":"               << s.ttProbes
+       << ",\"tt_hits\":"                 << s.ttHits
+       << ",\"tt_hit_rate\":"             << ratio(s.ttHits, s.ttProbes)
+       << ",\"tt_cutoffs\":"              << s.ttCutoffs
+       << ",\"beta_cutoffs\":"            << s.betaCutoffs
+       << ",\"first_move_cutoffs\":"      << s.firstMoveCutoffs
+       << ",\"first_move_cutoff_rate\":"  << ratio(s.firstMoveCutoffs, s.betaCutoffs)
+       << ",\"hash_move_cutoffs\":"       << s.hashMoveCutoffs
+       << ",\"null_move_cutoffs\":"       << s.nullMoveCutoffs
+       << ",\"futility_prunes\":"         << s.futilityPrunes
+       << ",\"lmr_researches\":"          << s.lmrResearches
+       << ",\"move_pickers\":"            << s.movePickers
+       << ",\"hash_move_stage\":"         << s.hashMoveStage
+       << ",\"capture_stage\":"           << s.captureStage
+       << ",\"killer_stage\":"            << s.killerStage
+       << ",\"quiet_stage\":"             << s.quietStage
+       << ",\"pawn_probes\":"             << s.pawnProbes
+       << ",\"pawn_hits\":"               << s.pawnHits
+       << ",\"bitbase_probes\":"          << s.bitbaseProbes
+       << ",\"bitbase_hits\":"            << s.bitbaseHits
+       << ",\"iterations\":[";
+    for (size_t i = 0; i < its.size(); ++i)
+      os << (i ? "," : "") << "{\"depth\":" << its[i].depth << ",\"score\":" << its[i].score
+         << ",\"bestmove\":\"" << Board::moveToString(its[i].bestMove) << "\",\"nodes\":" << its[i].nodes
+         << ",\"time_ms\":" << its[i].timeMs << "}";
+    os << "]}";
+    return os.str();
+  }
 
-    sortMoves(moves);
-    for (auto [from,to] : moves) {
-        auto rec = board.makeMove(from,to);
-        int score = -alphaBeta(board, depth-1, -β, -α);
+  static uint64_t statsKey = 0;   // hash key of the last completed search's root
 
-        if (score >= β) {
-            // β-cutoff: restore state _once_ and bail
-            board.unmakeMove(rec);
+  std::string statsJson() { return toJson(statsKey, stats, iterations); }
+
+  static void writeStats(uint64_t key, const Stats& s, const std::vector<IterationStats>& its) {
+    if (!statsOut)
+      return;
+    std::string line = toJson(key, s, its);
+    std::lock_guard<std::mutex> lock(statsOutMutex);
+    *statsOut << line << std::endl;
+  }
+
+  void setThreads(int n) {
+    n = std::clamp(n, 1, 512);
+    threads.clear();
+    for (int i = 0; i < n; ++i) {
+      threads.push_back(std::make_unique<ThreadData>());
+      threads.back()->id = i;
+    }
+  }
+  int threadCount() { return int(threads.size()); }
+
+  void clear() {
+    if (threads.empty()) setThreads(1);
+    TT.clear();
+    for (auto& t : threads) {
+      for (auto& k : t->killers) k[0] = k[1] = Move();
+      for (auto& side : t->history) for (auto& from : side) for (int& h : from) h = 0;
+      for (auto& piece : t->counterMoves) for (Move& m : piece) m = Move();
+    }
+  }
+
+  // Mate scores are stored relative to the node, not the root, so they stay valid at any ply
+  static int scoreToTT(int score, int ply) {
+    if (score >=  MATE_SCORE - MAX_PLY) return score + ply;
+    if (score <= -MATE_SCORE + MAX_PLY) return score - ply;
+    return score;
+  }
+  static int scoreFromTT(int score, int ply) {
+    if (score >=  MATE_SCORE - MAX_PLY) return score - ply;
+    if (score <= -MATE_SCORE + MAX_PLY) return score + ply;
+    return score;
+  }
+
+  // Ordering keys: hash move, then captures by MVV-LVA (queen promotions alongside them),
+  // then killers, the counter-move, and the remaining quiets by history
+  constexpr int HASH_MOVE_SCORE = 1 << 30;
+  constexpr int CAPTURE_SCORE   = 1 << 28;
+  constexpr int KILLER_SCORE    = 1 << 26;
+  constexpr int COUNTER_SCORE   = KILLER_SCORE - 2;
+  constexpr int HISTORY_MAX     = 1 << 14;
+
+  // Captures by MVV-LVA, queen promotions alongside them; a capture that underpromotes comes
+  // after every other capture
+  static int captureScore(const Board& board, Move m) {
+    PieceType victim   = m.flags() == EN_PASSANT ? PAWN
+                       : m.isCapture() ? typeOf(board.pieceOn(m.to())) : PAWN;
+    PieceType attacker = typeOf(board.pieceOn(m.from()));
+    int score = CAPTURE_SCORE + victim * 16 - attacker;
+    if (m.isPromotion())
+        score += m.promotion() == 'Q' ? 64 : -128;
+    return score;
+  }
+
+  // Reply to the previous move that refuted it last time, by [moved Piece][to]
+  static Move counterMove(const ThreadData& td, int ply) {
+    if (ply == 0 || !td.stack[ply - 1].rec.move)
+      return Move();
+    int prevTo = td.stack[ply - 1].rec.move.to();
+    return td.counterMoves[td.board.pieceOn(prevTo)][prevTo];
+  }
+
+  static void scoreMoves(const ThreadData& td, StackEntry& ss, Move hashMove, int ply) {
+    const Board& board = td.board;
+    Move counter = counterMove(td, ply);
+    for (int i = 0; i < ss.moves.size(); ++i) {
+      Move m = ss.moves[i];
+      int& sc = ss.scores[i];
+      if (m == hashMove) {
+        sc = HASH_MOVE_SCORE;
+      } else if (m.isCapture() || m.flags() == PROMO_QUEEN) {
+        sc = captureScore(board, m);
+      } else if (m == td.killers[ply][0]) {
+        sc = KILLER_SCORE;
+      } else if (m == td.killers[ply][1]) {
+        sc = KILLER_SCORE - 1;
+      } else if (m == counter) {
+        sc = COUNTER_SCORE;
+      } else {
+        sc = td.history[board.sideToMove][m.from()][m.to()];
+      }
+    }
+  }
+
+  // Selection step: bring the best remaining move to index i and return it
+  static Move pickMove(StackEntry& ss, int i) {
+    int best = i;
+    for (int j = i + 1; j < ss.moves.size(); ++j)
+      if (ss.scores[j] > ss.scores[best]) best = j;
+    std::swap(ss.moves[i],  ss.moves[best]);
+    std::swap(ss.scores[i], ss.scores[best]);
+    return ss.moves[i];
+  }
+
+  // Staged move generation for alphaBeta, in the order scoreMoves would sort a full list:
+  //   hash move -> captures and queen promotions -> killers, counter-move -> quiets -> underpromotions
+  // Each stage is produced only when the search asks past the previous one, so a node that cuts
+  // off on the hash move never generates, and one that cuts off on a capture never generates
+  // quiets. The hash move and refutations come from other positions and are checked with
+  // Board::isLegal. ss.moves and ss.scores hold the captures, then the quiets.
+  class MovePicker {
+  public:
+    MovePicker(ThreadData& td, int ply, Move hashMove)
+      : td(td), ss(td.stack[ply]), ply(ply), hashMove(hashMove) { td.stats.movePickers++; }
+
+    // Next move to search, or a null Move when all legal moves have been returned
+    Move next();
+
+  private:
+    enum Stage { HASH_MOVE, GEN_CAPTURES, CAPTURES, GEN_REFUTATIONS, REFUTATIONS,
+                 GEN_QUIETS, QUIETS, UNDERPROMOTIONS, DONE };
+
+    bool alreadyTried(Move m) const {
+      return m == hashMove || std::find(refutations, refutations + refutationCount, m) != refutations + refutationCount;
+    }
+
+    ThreadData& td;
+    StackEntry& ss;
+    int   ply;
+    Move  hashMove;
+    Stage stage = HASH_MOVE;
+    int   cur   = 0;
+    Move  refutations[3];
+    int   refutationCount = 0;
+    Move  underpromotions[32];      // quiet ones: at most 8 pawns x 3 pieces
+    int   underpromotionCount = 0;
+  };
+
+  Move MovePicker::next() {
+    const Board& board = td.board;
+    switch (stage) {
+    case HASH_MOVE:
+      stage = GEN_CAPTURES;
+      if (hashMove && board.isLegal(hashMove)) {
+        td.stats.hashMoveStage++;
+        return hashMove;
+      }
+      [[fallthrough]];
+
+    case GEN_CAPTURES: {
+      td.stats.captureStage++;
+      board.generateLegalCaptures(ss.moves);
+      int n = 0;
+      for (Move m : ss.moves) {
+        if (m == hashMove)
+          continue;
+        if (!m.isCapture() && m.flags() != PROMO_QUEEN)
+          underpromotions[underpromotionCount++] = m;
+        else
+          ss.moves[n++] = m;
+      }
+      ss.moves.count = n;
+      for (int i = 0; i < n; ++i)
+        ss.scores[i] = captureScore(board, ss.moves[i]);
+      cur   = 0;
+      stage = CAPTURES;
+      [[fallthrough]];
+    }
+
+    case CAPTURES:
+      if (cur < ss.moves.size())
+        return pickMove(ss, cur++);
+      stage = GEN_REFUTATIONS;
+      [[fallthrough]];
+
+    case GEN_REFUTATIONS:
+      td.stats.killerStage++;
+      for (Move m : { td.killers[ply][0], td.killers[ply][1], counterMove(td, ply) })
+        if (m && !m.isCapture() && !m.isPromotion() && !alreadyTried(m))
+          refutations[refutationCount++] = m;
+      cur   = 0;
+      stage = REFUTATIONS;
+      [[fallthrough]];
+
+    case REFUTATIONS:
+      while (cur < refutationCount) {
+        Move m = refutations[cur++];
+        if (board.isLegal(m))
+          return m;
+      }
+      stage = GEN_QUIETS;
+      [[fallthrough]];
+
+    case GEN_QUIETS: {
+      td.stats.quietStage++;
+      board.generateLegalQuiets(ss.moves);
+      int n = 0;
+      for (Move m : ss.moves)
+        if (!alreadyTried(m))
+          ss.moves[n++] = m;
+      ss.moves.count = n;
+      const auto& history = td.history[board.sideToMove];
+      for (int i = 0; i < n; ++i)
+        ss.scores[i] = history[ss.moves[i].from()][ss.moves[i].to()];
+      cur   = 0;
+      stage = QUIETS;
+      [[fallthrough]];
+    }
+
+    case QUIETS:
+      if (cur < ss.moves.size())
+        return pickMove(ss, cur++);
+      cur   = 0;
+      stage = UNDERPROMOTIONS;
+      [[fallthrough]];
+
+    case UNDERPROMOTIONS:
+      if (cur < underpromotionCount)
+        return underpromotions[cur++];
+      stage = DONE;
+      [[fallthrough]];
+
+    case DONE:
+      break;
+    }
+    return Move();
+  }
+
+  // History with gravity: bonuses shrink as the entry approaches HISTORY_MAX, so it never overflows
+  static void updateHistory(int& h, int bonus) {
+    h += bonus - h * std::abs(bonus) / HISTORY_MAX;
+  }
+
+  // A quiet move caused a beta cutoff: reward it, punish the quiets tried before it,
+  // and remember it as a killer for this ply and as the reply to the previous move
+  static void updateQuietStats(ThreadData& td, int ply, int depth, Move best, const MoveList& tried) {
+    Color side = td.board.sideToMove;
+    int bonus = std::min(depth * depth, 400);
+    updateHistory(td.history[side][best.from()][best.to()], bonus);
+    for (Move q : tried)
+      if (q != best)
+        updateHistory(td.history[side][q.from()][q.to()], -bonus);
+
+    if (td.killers[ply][0] != best) {
+      td.killers[ply][1] = td.killers[ply][0];
+      td.killers[ply][0] = best;
+    }
+    if (ply > 0 && td.stack[ply - 1].rec.move) {
+      int prevTo = td.stack[ply - 1].rec.move.to();
+      td.counterMoves[td.board.pieceOn(prevTo)][prevTo] = best;
+    }
+  }
+
+  // Root ordering: the previous best move first, everything else as in the tree
+  static void sortRootMoves(ThreadData& td, Move best) {
+    StackEntry& root = td.stack[0];
+    scoreMoves(td, root, best, 0);
+    for (int i = 0; i < root.moves.size(); ++i)
+      pickMove(root, i);
+  }
+
+  using Clock = std::chrono::steady_clock;
+
+  // Limits and stop signal of one search, shared by every thread working on it. initLimits turns
+  // the Limits into deadlines (ms since startTicks; 0 = none). The stop flag, clock start and
+  // ponder flag are atomic because stop() and ponderhit() arrive from other threads.
+  struct SearchControl {
+    std::atomic<bool>       stop       { false };
+    std::atomic<bool>       pondering  { false };
+    std::atomic<Clock::rep> startTicks { 0 };
+    int64_t  softDeadline = 0;   // don't start another iteration after this
+    int64_t  hardDeadline = 0;   // abort the iteration in progress
+    uint64_t nodeLimit    = 0;   // main thread nodes
+    bool     report       = false;   // pass completed iterations to the iteration handler
+  };
+
+  // The search run by findBestMove and start() on the shared thread pool
+  static SearchControl mainControl;
+
+  // Safety margin for I/O and thread wake-up between our clock and the caller's
+  constexpr int64_t MOVE_OVERHEAD = 20;
+
+  static int64_t elapsedMs(const SearchControl& ctl) {
+    auto since = Clock::now().time_since_epoch() - Clock::duration(ctl.startTicks.load(std::memory_order_relaxed));
+    return std::chrono::duration_cast<std::chrono::milliseconds>(since).count();
+  }
+
+  // A fixed movetime is spent in full. On a clock we aim for an even share of the remaining time
+  // (plus most of the increment), stop deepening at half of it because the next iteration usually
+  // costs more than all previous ones together, and let an unfinished iteration run to 3x.
+  static void initLimits(SearchControl& ctl, const Limits& limits, Color us) {
+    ctl.startTicks   = Clock::now().time_since_epoch().count();
+    ctl.softDeadline = ctl.hardDeadline = 0;
+    ctl.nodeLimit    = limits.nodes;
+    if (limits.infinite)
+      return;
+
+    if (limits.movetime > 0) {
+      ctl.softDeadline = ctl.hardDeadline = std::max<int64_t>(1, limits.movetime - MOVE_OVERHEAD);
+    } else if (limits.time[us] > 0) {
+      int64_t avail  = std::max<int64_t>(1, limits.time[us] - MOVE_OVERHEAD);
+      int     mtg    = limits.movesToGo > 0 ? std::min(limits.movesToGo, 40) : 40;
+      int64_t target = std::min(avail / mtg + limits.inc[us] * 3 / 4, avail / 2);
+      ctl.softDeadline = std::max<int64_t>(1, target / 2);
+      ctl.hardDeadline = std::max<int64_t>(1, std::min(target * 3, avail * 3 / 4));
+    }
+  }
+
+  // Main thread only: raise the stop flag once a hard limit is crossed. Depth 1 always completes,
+  // so there is a move to play however tight the limits are.
+  static void checkLimits(const ThreadData& td) {
+    SearchControl& ctl = *td.control;
+    if (td.completedDepth == 0 || ctl.pondering.load(std::memory_order_relaxed))
+      return;
+    if ((ctl.hardDeadline && elapsedMs(ctl) >= ctl.hardDeadline) || (ctl.nodeLimit && td.stats.nodes >= ctl.nodeLimit))
+      ctl.stop = true;
+  }
+
+  // Count a node; every 1024 of them the main thread checks the limits (the clock read is
+  // the expensive part) and every thread polls the shared stop flag
+  static bool checkAbort(ThreadData& td) {
+    if ((++td.stats.nodes & 1023) == 0) {
+      td.sharedNodes.store(td.stats.nodes, std::memory_order_relaxed);
+      if (td.id == 0)
+        checkLimits(td);
+      if (td.control->stop.load(std::memory_order_relaxed))
+        td.aborted = true;
+    }
+    return td.aborted;
+  }
+
+  // A capture can't raise the score by more than its victim plus this much positional slack
+  constexpr int DELTA_MARGIN = 200;
+
+  // Quiescence search: resolve captures (and queen promotions) until the position is quiet, so the
+  // static evaluation is never taken halfway through an exchange. The side to move may stand pat
+  // on the static score; captures that can't reach α or that lose material by SEE are skipped.
+  // In check there is no standing pat, and every evasion is searched.
+  static int quiescence(ThreadData& td, int ply, int α, int β) {
+    Board& board = td.board;
+    td.stats.qnodes++;
+    if (checkAbort(td))
+        return 0;
+    if (ply >= MAX_PLY)
+        return Eval::evaluate(board, td.pawns, td.params.nnue);
+
+    StackEntry& ss = td.stack[ply];
+    bool inCheck   = board.isKingInCheck(board.sideToMove);
+    int  standPat  = -INF;
+    if (inCheck) {
+        board.generateAllLegalMoves(ss.moves);
+        if (ss.moves.empty())
+            return -MATE_SCORE + ply;
+    } else {
+        standPat = Eval::evaluate(board, td.pawns, td.params.nnue);
+        if (standPat >= β)
             return β;
+        α = std::max(α, standPat);
+        board.generateLegalCaptures(ss.moves);
+    }
+
+    scoreMoves(td, ss, Move(), ply);
+    for (int i = 0; i < ss.moves.size(); ++i) {
+        Move m = pickMove(ss, i);
+        if (!inCheck) {
+            if (m.isPromotion() && m.promotion() != 'Q')
+                continue;
+            if (!m.isPromotion()) {
+                int victim = m.flags() == EN_PASSANT ? Eval::PieceValue[PAWN]
+                                                     : Eval::PieceValue[typeOf(board.pieceOn(m.to()))];
+                if (standPat + victim + DELTA_MARGIN <= α)
+                    continue;
+            }
+            if (board.see(m) < 0)
+                continue;
         }
 
-        // no cutoff → restore and continue
-        board.unmakeMove(rec);
+        ss.rec = board.makeMove(m);
+        int score = -quiescence(td, ply + 1, -β, -α);
+        board.unmakeMove(ss.rec);
+        if (td.aborted)
+            return 0;
+
+        if (score >= β)
+            return β;
         α = std::max(α, score);
     }
     return α;
-}
+  }
 
+  // Selectivity. Depth limits are in plies remaining, margins in centipawns.
+  constexpr int RFP_DEPTH        = 6;     // reverse futility: static eval beats β by Params::rfpMargin per ply
+  constexpr int NULL_MOVE_DEPTH  = 3;     // null move from here, reduced by 3 + depth/6
+  constexpr int FUTILITY_DEPTH   = 3;     // futility: quiets can't lift the static eval to α
+  constexpr int FUTILITY_MARGIN[FUTILITY_DEPTH + 1] = { 0, 200, 350, 500 };
+  constexpr int LMR_DEPTH        = 3;     // late-move reductions from this depth...
+  constexpr int LMR_MOVES        = 3;     // ...for quiet moves after this many were searched
 
-  std::pair<int,int> findBestMove(Board& board, int maxDepth) {
-    std::pair<int,int> bestMove{-1, -1};
+  // Late-move reduction in plies by [depth][moves searched]: 0.75 + ln(depth) * ln(moves) / 2.25
+  static const auto LMR_TABLE = [] {
+    std::array<std::array<uint8_t, 64>, MAX_PLY + 1> t{};
+    for (int d = 1; d <= MAX_PLY; ++d)
+      for (int m = 1; m < 64; ++m)
+        t[d][m] = uint8_t(0.75 + std::log(d) * std::log(m) / 2.25);
+    return t;
+  }();
 
-        for (int d = 1; d <= maxDepth; ++d) {
-            int α = -100000, β = +100000;
-            int bestScoreThisDepth = std::numeric_limits<int>::min();
-            std::pair<int,int> bestMoveThisDepth{-1,-1};
+  // Principal variation search. The first move gets the full window, every later one a null
+  // window (searched reduced if it's a late quiet move) and a full re-search only if it beats α.
+  // Nodes off the PV (null window) may also be cut without searching moves:
+  //  - reverse futility: the static eval is so far above β that no move should drop it below
+  //  - null move: passing the turn still holds β, so a real move would too. Skipped when the side
+  //    to move has nothing but pawns, where zugzwang makes passing better than every move.
+  //  - futility: near the leaves, quiet moves that don't give check can't raise a hopeless static
+  //    eval to α (the first move is always searched)
+  int alphaBeta(ThreadData& td, int ply, int depth, int α, int β) {
+    Board& board = td.board;
 
-            auto moves = board.generateAllLegalMoves();
-            sortMoves(moves);
+    if (depth <= 0)
+        return quiescence(td, ply, α, β);
 
-            for (auto [from,to] : moves) {
-                auto rec = board.makeMove(from,to);
-                int score = -alphaBeta(board, d-1, -β, -α);
-                board.unmakeMove(rec);
+    // Once the stop flag is seen, unwind without trusting any score
+    if (checkAbort(td))
+        return 0;
 
-                if (score > bestScoreThisDepth) {
-                    bestScoreThisDepth   = score;
-                    bestMoveThisDepth    = {from,to};
-                }
-                α = std::max(α, score);
+    if (ply >= MAX_PLY)
+        return Eval::evaluate(board, td.pawns, td.params.nnue);
+
+    // Bitbases: a known draw needs no search. Known wins carry on, so the search finds the mate,
+    // guided by the evaluation's known-win scores.
+    if (__builtin_popcountll(board.allPieces) <= Bitbases::MAX_PIECES) {
+        td.stats.bitbaseProbes++;
+        Bitbases::Outcome outcome = Bitbases::probe(board);
+        if (outcome != Bitbases::UNKNOWN)
+            td.stats.bitbaseHits++;
+        if (outcome == Bitbases::DRAW)
+            return 0;
+    }
+
+    bool pvNode = β - α > 1;
+
+    // Transposition table: answer from a deep enough bound (off the PV, so the PV stays whole),
+    // otherwise just take its move
+    TTData tte;
+    Move   hashMove;
+    td.stats.ttProbes++;
+    if (td.tt->probe(board.hashKey, tte)) {
+        td.stats.ttHits++;
+        hashMove = tte.move;
+        if (!pvNode && tte.depth >= depth) {
+            int s = scoreFromTT(tte.score, ply);
+            if (tte.bound == BOUND_EXACT
+                || (tte.bound == BOUND_LOWER && s >= β)
+                || (tte.bound == BOUND_UPPER && s <= α)) {
+                td.stats.ttCutoffs++;
+                return std::clamp(s, α, β);
             }
+        }
+    }
 
-            // logging used for debugging
-            // std::cout << "Depth " << d << ": move "
-            //         << Board::idxToCoord(bestMoveThisDepth.first)
-            //         << Board::idxToCoord(bestMoveThisDepth.second)
-            //         << " score " << bestScoreThisDepth << "\n";
+    StackEntry& ss = td.stack[ply];
+    bool inCheck    = board.isKingInCheck(board.sideToMove);
+    int  staticEval = inCheck ? -INF : Eval::evaluate(board, td.pawns, td.params.nnue);
+    bool mateBounds = std::abs(α) >= MATE_SCORE - MAX_PLY || std::abs(β) >= MATE_SCORE - MAX_PLY;
 
-            bestMove = bestMoveThisDepth;
+    if (!pvNode && !inCheck && !mateBounds) {
+        if (td.params.reverseFutility && depth <= RFP_DEPTH && staticEval - td.params.rfpMargin * depth >= β)
+            return β;
+
+        if (td.params.nullMove && depth >= NULL_MOVE_DEPTH && staticEval >= β
+            && td.stack[ply - 1].rec.move                       // no two null moves in a row
+            && board.nonPawnMaterial(board.sideToMove) > 0) {
+            int R = 3 + depth / 6;
+            ss.rec = board.makeNullMove();
+            int score = -alphaBeta(td, ply+1, depth-1-R, -β, -β+1);
+            board.unmakeNullMove(ss.rec);
+            if (td.aborted)
+                return 0;
+            if (score >= β) {
+                td.stats.nullMoveCutoffs++;
+                return β;
+            }
         }
+    }
+
+    bool futile = td.params.futility && !pvNode && !inCheck && !mateBounds
+                  && depth <= FUTILITY_DEPTH && staticEval + FUTILITY_MARGIN[depth] <= α;
 
-        return bestMove;
+    MovePicker picker(td, ply, hashMove);
+    ss.quietsTried.clear();
+    Move best;
+    int  searched = 0, legal = 0;
+    while (Move m = picker.next()) {
+        legal++;
+        bool quiet = !m.isCapture() && !m.isPromotion();
+        ss.rec = board.makeMove(m);
+        bool givesCheck = board.isKingInCheck(board.sideToMove);
+
+        if (futile && quiet && searched > 0 && !givesCheck) {
+            board.unmakeMove(ss.rec);
+            td.stats.futilityPrunes++;
+            continue;
+        }
+
+        int score;
+        if (searched == 0) {
+            score = -alphaBeta(td, ply+1, depth-1, -β, -α);
+        } else {
+            int r = 0;
+            if (td.params.lmr && depth >= LMR_DEPTH && searched >= LMR_MOVES && quiet && !inCheck && !givesCheck) {
+                r = LMR_TABLE[depth][std::min(searched, 63)];
+                r -= pvNode;
+                r -= (m == td.killers[ply][0] || m == td.killers[ply][1]);
+                r = std::clamp(r, 0, depth - 2);
+            }
+            score = -alphaBeta(td, ply+1, depth-1-r, -α-1, -α);
+            if (r > 0 && score > α) {
+                td.stats.lmrResearches++;
+                score = -alphaBeta(td, ply+1, depth-1, -α-1, -α);
+            }
+            if (score > α && score < β)
+                score = -alphaBeta(td, ply+1, depth-1, -β, -α);
+        }
+
+        // no matter what, restore state before deciding
+        board.unmakeMove(ss.rec);
+        if (td.aborted)
+            return 0;
+        searched++;
+        if (quiet)
+            ss.quietsTried.add(m);   // only searched moves take the history malus
+
+        if (score >= β) {
+            // β-cutoff: remember the refutation and bail
+            td.stats.betaCutoffs++;
+            if (searched == 1) td.stats.firstMoveCutoffs++;
+            if (m == hashMove) td.stats.hashMoveCutoffs++;
+            if (quiet)
+                updateQuietStats(td, ply, depth, m, ss.quietsTried);
+            td.tt->store(board.hashKey, m, scoreToTT(β, ply), depth, BOUND_LOWER);
+            return β;
+        }
+        if (score > α) {
+            α    = score;
+            best = m;
+        }
     }
+    if (!legal)
+        return inCheck ? -MATE_SCORE + ply : 0;
+    td.tt->store(board.hashKey, best, scoreToTT(α, ply), depth, best ? BOUND_EXACT : BOUND_UPPER);
+    return α;
+}
+
+  static IterationHandler iterationHandler;
+
+  void onIteration(IterationHandler handler) { iterationHandler = std::move(handler); }
+
+  // Principal variation: the root move followed by the hash moves stored below it, each checked
+  // for legality. Stops at the first missing entry or a position repeated along the line.
+  static std::vector<Move> extractPV(const TranspositionTable& tt, Board board, Move first, int maxLength) {
+    std::vector<Move>     pv;
+    std::vector<uint64_t> seen { board.hashKey };
+    MoveList legal;
+    TTData   tte;
+    Move     m = first;
+    while (m && int(pv.size()) < maxLength) {
+        pv.push_back(m);
+        board.makeMove(m);
+        if (std::find(seen.begin(), seen.end(), board.hashKey) != seen.end())
+            break;
+        seen.push_back(board.hashKey);
+        if (!tt.probe(board.hashKey, tte))
+            break;
+        board.generateAllLegalMoves(legal);
+        m = std::find(legal.begin(), legal.end(), tte.move) != legal.end() ? tte.move : Move();
+    }
+    return pv;
+  }
+
+  static Iteration makeIteration(const ThreadData& td) {
+    Iteration it;
+    it.depth    = td.completedDepth;
+    it.score    = td.bestScore;
+    it.timeMs   = elapsedMs(*td.control);
+    it.hashfull = td.tt->hashfull();
+    it.nodes    = td.stats.nodes;
+    for (auto& t : threads)
+      if (t.get() != &td) it.nodes += t->sharedNodes.load(std::memory_order_relaxed);
+    it.pv = extractPV(*td.tt, td.board, td.bestMove, td.completedDepth);
+    return it;
+  }
+
+  // Root move order for one (re)search: 'first' leads, then the usual ordering. Helpers rotate
+  // the moves after it so each thread opens a different subtree.
+  static void orderRoot(ThreadData& td, Move first) {
+    StackEntry& root = td.stack[0];
+    sortRootMoves(td, first);
+    if (td.id > 0 && root.moves.size() > 2) {
+      int shift = 1 + (td.id - 1) % (root.moves.size() - 1);
+      std::rotate(root.moves.begin() + 1, root.moves.begin() + shift, root.moves.end());
+    }
+  }
+
+  // Persistent analysis cache (Cache::open). It stands behind the shared table only: searches
+  // on a private table (matches) neither read nor write it.
+  static bool usesCache(const ThreadData& td) { return Cache::isOpen() && td.tt == &TT; }
+
+  // Copy the cached line from the root into the table: each stored move is followed while it is
+  // legal, so the search starts with its previous principal variation already in place
+  static void seedFromCache(TranspositionTable& tt, Board board) {
+    std::vector<uint64_t> seen;
+    MoveList legal;
+    TTData   cached;
+    while (int(seen.size()) < MAX_PLY && Cache::probe(board.hashKey, cached)) {
+        if (std::find(seen.begin(), seen.end(), board.hashKey) != seen.end())
+            break;
+        seen.push_back(board.hashKey);
+        tt.store(board.hashKey, cached.move, cached.score, cached.depth, cached.bound);
+        board.generateAllLegalMoves(legal);
+        if (!cached.move || std::find(legal.begin(), legal.end(), cached.move) == legal.end())
+            break;
+        board.makeMove(cached.move);
+    }
+  }
+
+  // Write the root result and the table's entries along the principal variation back to the
+  // cache; Cache::store keeps whichever of old and new was searched deeper
+  static void writeToCache(const TranspositionTable& tt, Board board, const std::vector<Move>& pv,
+                           int score, int depth) {
+    if (pv.empty() || depth == 0)
+        return;
+    std::vector<Cache::Record> records { { board.hashKey, { pv[0], scoreToTT(score, 0), depth, BOUND_EXACT } } };
+    TTData tte;
+    for (Move m : pv) {
+        board.makeMove(m);
+        if (tt.probe(board.hashKey, tte) && tte.bound != BOUND_NONE)
+            records.push_back({ board.hashKey, tte });
+    }
+    Cache::store(records);
+  }
+
+  // One pass over the root moves with window (α, β), principal variation search as in alphaBeta.
+  // Fail-hard like alphaBeta: a fail low returns α, and the first move to reach β ends the pass.
+  // The move behind the score is left in 'best'.
+  static int searchRoot(ThreadData& td, int depth, int α, int β, Move& best) {
+    Board& board = td.board;
+    StackEntry& root = td.stack[0];
+    int bestScore = -INF;
+    for (Move m : root.moves) {
+        root.rec = board.makeMove(m);
+        int score;
+        if (bestScore == -INF) {
+            score = -alphaBeta(td, 1, depth-1, -β, -α);
+        } else {
+            score = -alphaBeta(td, 1, depth-1, -α-1, -α);
+            if (score > α && score < β)
+                score = -alphaBeta(td, 1, depth-1, -β, -α);
+        }
+        board.unmakeMove(root.rec);
+        if (td.aborted)
+            return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+            best      = m;
+        }
+        if (score >= β)
+            break;
+        α = std::max(α, score);
+    }
+    return bestScore;
+  }
+
+  // Aspiration windows open at this depth, Params::aspirationDelta wide around the previous score,
+  // and grow by half on each failure
+  constexpr int ASPIRATION_DEPTH = 4;
+
+  // Iterative deepening for one thread. Helpers diverge from the main thread in two ways:
+  // odd ids start one ply deeper (so threads sit on different depths at any moment) and
+  // every helper rotates the root moves after the hash move so they open different subtrees.
+  // From ASPIRATION_DEPTH on, each iteration opens with a narrow window around the previous score
+  // and widens it on the failing side until the score lands inside. An aborted iteration is
+  // discarded: td keeps the result of the last completed depth.
+  static void iterativeDeepening(ThreadData& td, int maxDepth) {
+    Board& board = td.board;
+    StackEntry& root = td.stack[0];
+    board.generateAllLegalMoves(root.moves);
+    if (root.moves.empty())
+        return;
+
+    // A cached exact root result leads the first iteration, and is the answer outright when it is
+    // already as deep as a depth-limited search would go
+    TTData cached;
+    if (usesCache(td) && Cache::probe(board.hashKey, cached) && cached.bound == BOUND_EXACT
+        && std::find(root.moves.begin(), root.moves.end(), cached.move) != root.moves.end()) {
+        td.bestMove = cached.move;
+        if (maxDepth < MAX_PLY - 1 && cached.depth >= maxDepth) {
+            td.bestScore      = scoreFromTT(cached.score, 0);
+            td.completedDepth = cached.depth;
+            const SearchControl& ctl = *td.control;
+            if (td.id == 0)
+                td.iterations.push_back(IterationStats{ cached.depth, td.bestScore, td.bestMove, 0, elapsedMs(ctl) });
+            if (td.id == 0 && ctl.report && iterationHandler)
+                iterationHandler(makeIteration(td));
+            return;
+        }
+    }
+
+    for (int d = 1 + (td.id & 1); d <= maxDepth; ++d) {
+        int delta = td.params.aspirationDelta;
+        int α = -INF, β = +INF;
+        if (d >= ASPIRATION_DEPTH && td.completedDepth > 0 && std::abs(td.bestScore) < MATE_SCORE - MAX_PLY) {
+            α = std::max(td.bestScore - delta, -INF);
+            β = std::min(td.bestScore + delta, +INF);
+        }
+
+        Move first = td.bestMove, bestMoveThisDepth;
+        int  bestScoreThisDepth;
+        while (true) {
+            orderRoot(td, first);
+            bestScoreThisDepth = searchRoot(td, d, α, β, bestMoveThisDepth);
+            if (td.aborted)
+                return;   // keep the last completed iteration
+
+            if (bestScoreThisDepth <= α && α > -INF) {
+                β = (α + β) / 2;
+                α = std::max(bestScoreThisDepth - delta, -INF);
+            } else if (bestScoreThisDepth >= β && β < +INF) {
+                β     = std::min(bestScoreThisDepth + delta, +INF);
+                first = bestMoveThisDepth;
+            } else {
+                break;
+            }
+            delta += delta / 2;
+        }
+        td.tt->store(board.hashKey, bestMoveThisDepth, scoreToTT(bestScoreThisDepth, 0), d, BOUND_EXACT);
+
+        bool changed      = td.bestMove != bestMoveThisDepth;
+        td.bestMove       = bestMoveThisDepth;
+        td.bestScore      = bestScoreThisDepth;
+        td.completedDepth = d;
+
+        const SearchControl& ctl = *td.control;
+        if (td.id == 0)
+            td.iterations.push_back(IterationStats{ d, bestScoreThisDepth, bestMoveThisDepth, td.stats.nodes, elapsedMs(ctl) });
+        if (td.id == 0 && ctl.report && iterationHandler)
+            iterationHandler(makeIteration(td));
+
+        // Soft deadline (main thread): stop deepening, allowing half as long again while the best move is unsettled
+        if (td.id == 0 && ctl.softDeadline && !ctl.pondering.load(std::memory_order_relaxed)
+            && elapsedMs(ctl) >= std::min(ctl.hardDeadline, changed ? ctl.softDeadline * 3 / 2 : ctl.softDeadline))
+            break;
+    }
+  }
+
+  // Each thread votes for its move, weighted by how far its score clears the worst one
+  // and by its completed depth; the deepest thread among the winning move's voters reports it.
+  static const ThreadData& pickBestThread() {
+    const ThreadData* best = threads[0].get();
+    int minScore = best->bestScore;
+    for (auto& t : threads)
+      if (t->completedDepth > 0) minScore = std::min(minScore, t->bestScore);
+
+    auto votes = [&](Move m) {
+      int64_t v = 0;
+      for (auto& t : threads)
+        if (t->completedDepth > 0 && t->bestMove == m)
+          v += int64_t(t->bestScore - minScore + 14) * t->completedDepth;
+      return v;
+    };
+    int64_t bestVotes = votes(best->bestMove);
+    for (auto& t : threads) {
+      if (t->completedDepth == 0) continue;
+      int64_t v = votes(t->bestMove);
+      if (v > bestVotes || (v == bestVotes && t->completedDepth > best->completedDepth)) {
+        best      = t.get();
+        bestVotes = v;
+      }
+    }
+    return *best;
+  }
+
+  // Wake-up for a finished search that must hold its result until stop() or ponderhit()
+  static std::mutex              holdMutex;
+  static std::condition_variable holdCv;
+
+  static int maxDepthOf(const Limits& limits) {
+    return limits.depth > 0 ? std::min(limits.depth, MAX_PLY - 1) : MAX_PLY - 1;
+  }
+
+  // Fresh per-search state for one thread; history is only aged, it stays useful across searches
+  static void prepareThread(ThreadData& td, const Board& board, SearchControl& ctl) {
+    td.control        = &ctl;
+    td.board          = board;
+    if (NNUE::isLoaded() && td.params.nnue)
+      td.board.attachNnue(&td.accumulators);
+    td.stats          = Stats{};
+    td.iterations.clear();
+    td.pawns.probes   = td.pawns.hits = 0;
+    td.sharedNodes    = 0;
+    for (auto& k : td.killers) k[0] = k[1] = Move();
+    for (auto& side : td.history) for (auto& from : side) for (int& h : from) h /= 2;
+    td.aborted        = false;
+    td.bestMove       = Move();
+    td.bestScore      = 0;
+    td.completedDepth = 0;
+  }
+
+  // A thread's counters, with the evaluation's pawn table lookups folded in
+  static Stats threadStats(const ThreadData& td) {
+    Stats s      = td.stats;
+    s.pawnProbes = td.pawns.probes;
+    s.pawnHits   = td.pawns.hits;
+    return s;
+  }
+
+  // Searches with the stop flag and ponder state already set up by the caller
+  static Move think(const Board& board, const Limits& limits) {
+    if (threads.empty()) setThreads(1);
+    TT.newSearch();
+    initLimits(mainControl, limits, board.sideToMove);
+    mainControl.report = true;
+    int maxDepth = maxDepthOf(limits);
+
+    for (auto& t : threads)
+      prepareThread(*t, board, mainControl);
+    if (usesCache(*threads[0]))
+      seedFromCache(TT, board);
+
+    // Helpers keep deepening until the main thread finishes its last iteration, but never past a
+    // depth limit: every thread's result is then one the caller asked for, whatever the thread count
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < threads.size(); ++i)
+      helpers.emplace_back(iterativeDeepening, std::ref(*threads[i]), maxDepth);
+
+    iterativeDeepening(*threads[0], maxDepth);
+
+    // An infinite or pondering search that ran out of depth still waits for the go-ahead
+    if (limits.infinite || limits.ponder) {
+      std::unique_lock<std::mutex> lock(holdMutex);
+      holdCv.wait(lock, [&] { return mainControl.stop.load() || (!limits.infinite && !mainControl.pondering.load()); });
+    }
+    mainControl.stop = true;
+    for (auto& h : helpers) h.join();
+
+    const ThreadData& best = pickBestThread();
+    stats = Stats{};
+    for (auto& t : threads)
+      stats += threadStats(*t);
+    stats.depth  = best.completedDepth;
+    stats.timeMs = elapsedMs(mainControl);
+    iterations   = threads[0]->iterations;
+    stats.ebf    = branchingFactor(iterations);
+    statsKey     = board.hashKey;
+    pvLine       = extractPV(TT, board, best.bestMove, best.completedDepth);
+    writeStats(statsKey, stats, iterations);
+    if (usesCache(best))
+      writeToCache(TT, board, pvLine, best.bestScore, best.completedDepth);
+
+    // Only an external stop during depth 1 leaves no result; any legal move beats none
+    if (!best.bestMove && !threads[0]->stack[0].moves.empty())
+      return threads[0]->stack[0].moves[0];
+    return best.bestMove;
+  }
+
+  Move findBestMove(Board& board, int maxDepth) {
+    Limits limits;
+    limits.depth = maxDepth;
+    return findBestMove(board, limits);
+  }
+
+  Move findBestMove(Board& board, const Limits& limits) {
+    mainControl.stop      = false;
+    mainControl.pondering = limits.ponder;
+    return think(board, limits);
+  }
+
+  Result searchPosition(ThreadData& td, const Board& board, const Limits& limits) {
+    SearchControl ctl;
+    initLimits(ctl, limits, board.sideToMove);
+    td.id = 0;
+    prepareThread(td, board, ctl);
+    if (usesCache(td))
+      seedFromCache(*td.tt, board);
+    iterativeDeepening(td, maxDepthOf(limits));
+    if (usesCache(td))
+      writeToCache(*td.tt, board, extractPV(*td.tt, board, td.bestMove, td.completedDepth),
+                   td.bestScore, td.completedDepth);
+
+    Result r;
+    r.bestMove = td.bestMove;
+    r.score    = td.bestScore;
+    r.depth    = td.completedDepth;
+    r.nodes    = td.stats.nodes;
+    r.timeMs   = elapsedMs(ctl);
+    if (!r.bestMove && !td.stack[0].moves.empty())
+      r.bestMove = td.stack[0].moves[0];
+    if (statsOut) {
+      Stats s  = threadStats(td);
+      s.depth  = r.depth;
+      s.timeMs = r.timeMs;
+      s.ebf    = branchingFactor(td.iterations);
+      writeStats(board.hashKey, s, td.iterations);
+    }
+    td.control = nullptr;
+    return r;
+  }
+
+  // The flags are set before the thread starts, so a stop() that follows immediately is never lost
+  static std::thread searchThread;
+
+  void start(const Board& board, const Limits& limits, std::function<void(Move)> onDone) {
+    wait();
+    mainControl.stop      = false;
+    mainControl.pondering = limits.ponder;
+    searchThread = std::thread([board, limits, onDone = std::move(onDone)] {
+      Move best = think(board, limits);
+      if (onDone) onDone(best);
+    });
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(holdMutex);
+      mainControl.stop = true;
+    }
+    holdCv.notify_all();
+  }
+
+  void ponderhit() {
+    {
+      std::lock_guard<std::mutex> lock(holdMutex);
+      mainControl.startTicks = Clock::now().time_since_epoch().count();
+      mainControl.pondering  = false;
+    }
+    holdCv.notify_all();
+  }
+
+  void wait() {
+    if (searchThread.joinable())
+      searchThread.join();
+  }
 
 } // namespace Search
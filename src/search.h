@@ -1,10 +1,193 @@
 #pragma once
 #include "board.h"
+#include "eval.h"
+#include "nnue.h"
+#include "tt.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
 
 namespace Search {
-  // Depth‐limited α-β search. Returns score *from* side‐to‐move’s perspective.
-  int alphaBeta(Board& board, int depth, int α, int β);
+  // Deepest ply the search stack can hold
+  constexpr int MAX_PLY = 64;
 
-  // convenience entry-point, e.g. iterative deepening
-  std::pair<int,int> findBestMove(Board& board, int maxDepth);
+  // Scores: mate in N plies is MATE_SCORE - N; INF bounds every window
+  constexpr int MATE_SCORE = 31000;
+  constexpr int INF        = 32000;
+
+  // Per-ply scratch space, preallocated so the search never touches the heap
+  struct StackEntry {
+    MoveList           moves;
+    std::array<int, MoveList::MAX_MOVES> scores;   // ordering keys for 'moves'
+    MoveList           quietsTried;                // quiet moves searched so far (history malus)
+    Board::MoveRecord  rec;
+  };
+  using Stack = std::array<StackEntry, MAX_PLY + 1>;
+
+  // Counters for one call to findBestMove. Each thread counts into its own copy with plain
+  // increments; the copies sit on separate cache lines and are summed once the search is over.
+  struct alignas(64) Stats {
+    uint64_t nodes           = 0;   // every node visited, quiescence included
+    uint64_t qnodes          = 0;   // the part of 'nodes' spent in quiescence search
+    uint64_t ttProbes        = 0;
+    uint64_t ttHits          = 0;
+    uint64_t ttCutoffs       = 0;   // nodes answered by a stored bound without searching
+    uint64_t hashMoveCutoffs = 0;   // beta cutoffs produced by the hash move, tried first
+    uint64_t betaCutoffs     = 0;
+    uint64_t firstMoveCutoffs = 0;  // beta cutoffs on the first move searched (ordering quality)
+    uint64_t nullMoveCutoffs = 0;
+    uint64_t futilityPrunes  = 0;   // quiet moves skipped by futility pruning
+    uint64_t lmrResearches   = 0;   // reduced searches that beat α and were repeated at full depth
+    uint64_t movePickers     = 0;   // alphaBeta nodes that reached the move loop, and the stages
+    uint64_t hashMoveStage   = 0;   //   they got to: a legal hash move was tried,
+    uint64_t captureStage    = 0;   //   captures were generated,
+    uint64_t killerStage     = 0;   //   killers and the counter-move were tried,
+    uint64_t quietStage      = 0;   //   quiet moves were generated
+    uint64_t pawnProbes      = 0;   // pawn structure table lookups by the evaluation
+    uint64_t pawnHits        = 0;
+    uint64_t bitbaseProbes   = 0;   // nodes with few enough pieces to look up
+    uint64_t bitbaseHits     = 0;   // of which a bitbase knew the result (draws end the node)
+    int      depth           = 0;   // completed depth of the thread whose move was played
+    int64_t  timeMs          = 0;   // wall-clock time of the search
+    double   ebf             = 0;   // effective branching factor over the main thread's iterations
+
+    // Sum of the counters (depth, time and ebf are set by whoever aggregates)
+    Stats& operator+=(const Stats& o);
+  };
+
+  // One completed iteration of the main thread
+  struct IterationStats {
+    int      depth    = 0;
+    int      score    = 0;
+    Move     bestMove;
+    uint64_t nodes    = 0;    // main thread, cumulative
+    int64_t  timeMs   = 0;    // since the search started
+  };
+
+  // Switchable parts of the search, per thread so that a match can play two settings against
+  // each other in one process. The defaults are the engine's own.
+  struct Params {
+    bool nnue            = true;    // evaluate with the loaded net, if any (false: classical)
+    bool reverseFutility = true;
+    int  rfpMargin       = 120;     // per ply of depth
+    bool nullMove        = true;
+    bool futility        = true;
+    bool lmr             = true;
+    int  aspirationDelta = 25;      // initial half-width of the aspiration window
+  };
+
+  // What to search for. Every limit left at 0 is off; with none set the search runs to MAX_PLY.
+  // time/inc are indexed by Color, so wtime/btime can be copied straight from a UCI "go".
+  struct Limits {
+    int      depth     = 0;
+    uint64_t nodes     = 0;          // nodes searched by the main thread
+    int64_t  movetime  = 0;          // ms for this move, spent in full
+    int64_t  time[2]   = { 0, 0 };   // remaining clock (ms)
+    int64_t  inc[2]    = { 0, 0 };   // increment per move (ms)
+    int      movesToGo = 0;          // moves until the next time control, 0 = sudden death
+    bool     infinite  = false;      // ignore time; run until depth/nodes or an external stop
+    bool     ponder    = false;      // ignore time until ponderhit(), then run on these limits
+  };
+
+  // Progress report of the main thread, made after each completed iteration
+  struct Iteration {
+    int               depth    = 0;
+    int               score    = 0;    // side to move's view; beyond ±(MATE_SCORE - MAX_PLY) it's a mate
+    uint64_t          nodes    = 0;    // all threads (helpers sampled every 1024 nodes)
+    int64_t           timeMs   = 0;
+    int               hashfull = 0;    // permille
+    std::vector<Move> pv;
+  };
+  using IterationHandler = std::function<void(const Iteration&)>;
+
+  // Limits and stop signal of one running search (internal to search.cpp)
+  struct SearchControl;
+
+  // Everything one search thread owns. Threads share only the transposition table.
+  struct alignas(64) ThreadData {
+    int    id      = 0;
+    SearchControl* control = nullptr;     // the search this thread is working on
+    TranspositionTable* tt = &TT;         // the shared table unless the owner brings its own
+    Params params;
+    Board  board;
+    Stack  stack;
+    NNUE::AccumulatorStack accumulators;   // attached to board while a net is loaded
+    Eval::PawnTable        pawns;          // kept across searches; its counters are per search
+    Stats  stats;
+    std::vector<IterationStats> iterations;   // main thread only
+    alignas(64) std::atomic<uint64_t> sharedNodes { 0 };   // stats.nodes, published for progress reports
+    bool   aborted = false;
+
+    // Move ordering tables, updated on beta cutoffs by quiet moves
+    Move   killers[MAX_PLY + 1][2];
+    int    history[2][64][64];          // [side][from][to]
+    Move   counterMoves[12][64];        // reply to the previous move, by [moved Piece][to]
+
+    // Result of the deepest iteration this thread completed
+    Move   bestMove;
+    int    bestScore      = 0;
+    int    completedDepth = 0;
+  };
+
+  // Depth‐limited α-β search on td.board. Returns score *from* side‐to‐move’s perspective.
+  int alphaBeta(ThreadData& td, int ply, int depth, int α, int β);
+
+  // convenience entry-point, e.g. iterative deepening. Returns a null Move if there are no legal moves.
+  // With more than one thread this runs Lazy SMP: helpers search copies of the board in parallel
+  // and fill the shared transposition table, and the final move is chosen by a depth-weighted vote.
+  // Time and node limits abort the search mid-iteration; the move of the last completed depth is returned.
+  // With an analysis cache open (Cache::open), searches on the shared table start from its stored
+  // line and write their own back; see iterativeDeepening.
+  Move findBestMove(Board& board, const Limits& limits);
+  Move findBestMove(Board& board, int maxDepth);
+
+  // Outcome of searchPosition
+  struct Result {
+    Move     bestMove;
+    int      score  = 0;
+    int      depth  = 0;
+    uint64_t nodes  = 0;
+    int64_t  timeMs = 0;
+  };
+
+  // Self-contained single-threaded search on the caller's ThreadData with its td.params. Only td.tt
+  // (the shared table unless replaced) is shared, so any number of these can run at once on
+  // different positions (batch analysis, match games); the thread pool, stop() and lastStats()
+  // are not involved. Limits::ponder is ignored.
+  Result searchPosition(ThreadData& td, const Board& board, const Limits& limits);
+
+  // Asynchronous search for front-ends: start() returns at once and runs the search on a thread
+  // of its own, calling onDone with the move from that thread. Infinite and ponder searches hold
+  // their move until stop() (or ponderhit(), which also restarts the clock for the real limits).
+  // wait() joins the finished search; start() waits for the previous one itself.
+  void start(const Board& board, const Limits& limits, std::function<void(Move)> onDone);
+  void stop();
+  void ponderhit();
+  void wait();
+
+  // Called on the main search thread after each completed iteration (empty = no reports)
+  void onIteration(IterationHandler handler);
+
+  // Number of search threads (the calling thread counts as one)
+  void setThreads(int n);
+  int  threadCount();
+
+  // Forget everything learned so far: transposition table and all move ordering tables
+  void clear();
+
+  // Statistics and principal variation of the last completed search
+  const Stats&                       lastStats();
+  const std::vector<IterationStats>& lastIterations();
+  const std::vector<Move>&           lastPV();
+
+  // The last completed search's statistics as one JSON object (no newline)
+  std::string statsJson();
+
+  // Write statsJson() as one line to 'out' after every search, batch analysis included
+  // (nullptr = off). The stream must outlive the searches.
+  void dumpStats(std::ostream* out);
 }
@@ -0,0 +1,72 @@
+// Transposition table storage, probing and replacement
+#include "tt.h"
+#include <algorithm>
+
+TranspositionTable TT;
+
+void TranspositionTable::resize(size_t mb) {
+    bucketCount = std::max<size_t>(1, (mb << 20) / sizeof(Bucket));
+    buckets     = std::make_unique<Bucket[]>(bucketCount);
+    generation  = 0;
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < bucketCount; ++i)
+        for (Entry &e : buckets[i].entries) {
+            e.check.store(0, std::memory_order_relaxed);
+            e.data .store(0, std::memory_order_relaxed);
+        }
+    generation = 0;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTData& out) const {
+    const Bucket &b = buckets[index(key)];
+    for (const Entry &e : b.entries) {
+        uint64_t d = e.data .load(std::memory_order_relaxed);
+        uint64_t c = e.check.load(std::memory_order_relaxed);
+        if ((c ^ d) != key || boundOf(d) == BOUND_NONE) continue;
+        out.move  = Move(); out.move.data = uint16_t(d);
+        out.score = int16_t(uint16_t(d >> 16));
+        out.depth = depthOf(d);
+        out.bound = boundOf(d);
+        return true;
+    }
+    return false;
+}
+
+// Replacement: reuse this position's slot (keeping its move if the new result has none),
+// otherwise evict the slot with the lowest depth, counting entries from older searches as shallower.
+void TranspositionTable::store(uint64_t key, Move move, int score, int depth, Bound bound) {
+    Bucket &b = buckets[index(key)];
+    Entry  *victim = nullptr;
+    int     worst  = 1 << 30;
+    for (Entry &e : b.entries) {
+        uint64_t d = e.data .load(std::memory_order_relaxed);
+        uint64_t c = e.check.load(std::memory_order_relaxed);
+        if ((c ^ d) == key) {
+            // Don't let a shallow non-exact result overwrite a deeper one for the same position
+            if (bound != BOUND_EXACT && depth + 2 < depthOf(d) && genOf(d) == generation)
+                return;
+            if (!move) move.data = uint16_t(d);
+            victim = &e;
+            break;
+        }
+        int age   = (generation - genOf(d)) & 63;
+        int value = boundOf(d) == BOUND_NONE ? -1000 : depthOf(d) - 8 * age;
+        if (value < worst) { worst = value; victim = &e; }
+    }
+    uint64_t d = pack(move, score, depth, bound, generation);
+    victim->data .store(d,       std::memory_order_relaxed);
+    victim->check.store(key ^ d, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    size_t samples = std::min<size_t>(1000, bucketCount);
+    int used = 0;
+    for (size_t i = 0; i < samples; ++i)
+        for (const Entry &e : buckets[i].entries) {
+            uint64_t d = e.data.load(std::memory_order_relaxed);
+            used += boundOf(d) != BOUND_NONE && genOf(d) == generation;
+        }
+    return int(used * 1000 / (samples * BUCKET_SIZE));
+}
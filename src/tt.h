@@ -0,0 +1,71 @@
+#pragma once
+
+#include "move.h"
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+
+// Bound type of a stored score
+enum Bound : uint8_t { BOUND_NONE = 0, BOUND_UPPER = 1, BOUND_LOWER = 2, BOUND_EXACT = 3 };
+
+// Unpacked result of a successful probe
+struct TTData {
+    Move  move;
+    int   score;
+    int   depth;
+    Bound bound;
+};
+
+// Shared transposition table.
+// Entries are two 64-bit words: the packed data and (key ^ data). A reader only accepts an entry
+// whose words XOR back to its key, so a torn write from another thread just looks like a miss
+// and no locks are needed.
+class TranspositionTable {
+public:
+    static constexpr int BUCKET_SIZE = 4;    // 4 x 16 bytes = one cache line
+
+    explicit TranspositionTable(size_t mb = 16) { resize(mb); }
+
+    void   resize(size_t mb);      // drops all entries
+    void   clear();
+    void   newSearch()             { generation = (generation + 1) & 63; }
+
+    bool   probe(uint64_t key, TTData& out) const;
+    void   store(uint64_t key, Move move, int score, int depth, Bound bound);
+    void   prefetch(uint64_t key) const { __builtin_prefetch(&buckets[index(key)]); }
+
+    size_t sizeMB()   const { return bucketCount * sizeof(Bucket) >> 20; }
+    int    hashfull() const;       // permille of sampled slots written during this search
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check { 0 };   // key ^ data
+        std::atomic<uint64_t> data  { 0 };
+    };
+    struct alignas(64) Bucket {
+        Entry entries[BUCKET_SIZE];
+    };
+
+    // data layout: move 0-15 | score 16-31 | depth 32-39 | bound 40-41 | generation 42-47
+    static uint64_t pack(Move m, int score, int depth, Bound b, uint8_t gen) {
+        return uint64_t(m.data)
+             | uint64_t(uint16_t(int16_t(score))) << 16
+             | uint64_t(uint8_t(depth)) << 32
+             | uint64_t(b) << 40
+             | uint64_t(gen) << 42;
+    }
+    static int     depthOf(uint64_t d) { return int((d >> 32) & 0xFF); }
+    static Bound   boundOf(uint64_t d) { return Bound((d >> 40) & 3); }
+    static uint8_t genOf  (uint64_t d) { return uint8_t((d >> 42) & 63); }
+
+    // Map the key onto [0, bucketCount) with a multiply instead of a modulo
+    size_t index(uint64_t key) const { return size_t((unsigned __int128)key * bucketCount >> 64); }
+
+    std::unique_ptr<Bucket[]> buckets;
+    size_t  bucketCount = 0;
+    uint8_t generation  = 0;
+};
+
+// The table shared by every search
+extern TranspositionTable TT;
@@ -0,0 +1,222 @@
+#include "uci.h"
+#include "board.h"
+#include "book.h"
+#include "cache.h"
+#include "nnue.h"
+#include "search.h"
+#include "tt.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace UCI {
+
+  // The search thread reports while the input thread answers commands; one line at a time
+  static std::mutex outputMutex;
+
+  static void send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << line << std::endl;
+  }
+
+  // "cp N" from the side to move's view, or "mate N" in moves (negative when getting mated)
+  static std::string scoreToString(int score) {
+    if (score >=  Search::MATE_SCORE - Search::MAX_PLY)
+      return "mate " + std::to_string((Search::MATE_SCORE - score + 1) / 2);
+    if (score <= -Search::MATE_SCORE + Search::MAX_PLY)
+      return "mate " + std::to_string(-(Search::MATE_SCORE + score) / 2);
+    return "cp " + std::to_string(score);
+  }
+
+  static void sendInfo(const Search::Iteration& it) {
+    std::ostringstream os;
+    os << "info depth " << it.depth
+       << " score "     << scoreToString(it.score)
+       << " nodes "     << it.nodes
+       << " nps "       << it.nodes * 1000 / uint64_t(std::max<int64_t>(it.timeMs, 1))
+       << " hashfull "  << it.hashfull
+       << " time "      << it.timeMs
+       << " pv";
+    for (Move m : it.pv)
+      os << ' ' << Board::moveToString(m);
+    send(os.str());
+  }
+
+  // Summary of the finished search for the GUI's log; the full record is the --stats dump
+  static void sendStats(const Search::Stats& st) {
+    auto percent = [](uint64_t part, uint64_t whole) { return whole ? part * 100 / whole : 0; };
+    std::ostringstream os;
+    os << "info string stats nodes " << st.nodes
+       << " qnodes "  << st.qnodes
+       << " fmc "     << percent(st.firstMoveCutoffs, st.betaCutoffs) << '%'
+       << " tthit "   << percent(st.ttHits, st.ttProbes) << '%'
+       << " ebf "     << std::fixed << std::setprecision(2) << st.ebf
+       << " depth "   << st.depth
+       << " time "    << st.timeMs;
+    send(os.str());
+  }
+
+  static void sendBestMove(Move best) {
+    sendStats(Search::lastStats());
+    std::string line = "bestmove " + (best ? Board::moveToString(best) : std::string("0000"));
+    const std::vector<Move>& pv = Search::lastPV();
+    if (pv.size() >= 2 && pv[0] == best)
+      line += " ponder " + Board::moveToString(pv[1]);
+    send(line);
+  }
+
+  // Coordinate move ("e2e4", "e7e8q") among the legal moves of 'board', or a null Move
+  static Move parseMove(const Board& board, const std::string& token) {
+    MoveList legal;
+    board.generateAllLegalMoves(legal);
+    for (Move m : legal)
+      if (Board::moveToString(m) == token)
+        return m;
+    return Move();
+  }
+
+  // position [startpos | fen <fen>] [moves <m1> <m2> ...]
+  static void position(Board& board, std::istringstream& is) {
+    std::string token, fen;
+    is >> token;
+    if (token == "startpos") {
+      fen = Board::START_FEN;
+      is >> token;                          // "moves", if any
+    } else if (token == "fen") {
+      while (is >> token && token != "moves")
+        fen += token + " ";
+    } else {
+      return;
+    }
+
+    try {
+      board.setFen(fen);
+    } catch (const std::invalid_argument& e) {
+      send(std::string("info string invalid fen: ") + e.what());
+      return;
+    }
+    while (is >> token) {
+      Move m = parseMove(board, token);
+      if (!m) {
+        send("info string illegal move " + token);
+        return;
+      }
+      board.makeMove(m);
+    }
+  }
+
+  // go [wtime N] [btime N] [winc N] [binc N] [movestogo N] [depth N] [nodes N] [movetime N] [infinite] [ponder]
+  static void go(const Board& board, std::istringstream& is) {
+    Search::Limits limits;
+    std::string token;
+    while (is >> token) {
+      if      (token == "wtime")     is >> limits.time[WHITE];
+      else if (token == "btime")     is >> limits.time[BLACK];
+      else if (token == "winc")      is >> limits.inc[WHITE];
+      else if (token == "binc")      is >> limits.inc[BLACK];
+      else if (token == "movestogo") is >> limits.movesToGo;
+      else if (token == "depth")     is >> limits.depth;
+      else if (token == "nodes")     is >> limits.nodes;
+      else if (token == "movetime")  is >> limits.movetime;
+      else if (token == "infinite")  limits.infinite = true;
+      else if (token == "ponder")    limits.ponder   = true;
+    }
+    // Book moves are played at once; infinite and ponder searches are analysis, so they search
+    if (!limits.infinite && !limits.ponder)
+      if (Move m = Book::probe(board)) {
+        send("bestmove " + Board::moveToString(m));
+        return;
+      }
+    Search::start(board, limits, sendBestMove);
+  }
+
+  // setoption name <Hash|Threads|EvalFile|BookFile|CacheFile> value <V>; other options are accepted and ignored
+  static void setOption(std::istringstream& is) {
+    std::string token, name, value;
+    is >> token;                            // "name"
+    while (is >> token && token != "value")
+      name += (name.empty() ? "" : " ") + token;
+    std::getline(is >> std::ws, value);     // file names may contain spaces
+
+    std::string error;
+    if (name == "Hash")
+      TT.resize(std::clamp(std::atoi(value.c_str()), 1, 65536));
+    else if (name == "Threads")
+      Search::setThreads(std::atoi(value.c_str()));
+    else if (name == "EvalFile" && !value.empty() && value != "<empty>") {
+      if (NNUE::load(value, error))
+        send("info string NNUE net " + value + " loaded");
+      else
+        send("info string NNUE " + error);
+    } else if (name == "BookFile" && !value.empty() && value != "<empty>") {
+      if (Book::open(value, error))
+        send("info string book " + value + " opened");
+      else
+        send("info string book " + error);
+    } else if (name == "CacheFile" && !value.empty() && value != "<empty>") {
+      if (Cache::open(value, Cache::DEFAULT_MB, error))
+        send("info string cache " + value + " opened");
+      else
+        send("info string cache " + error);
+    }
+  }
+
+  static void sendId() {
+    send("id name chess-bot 2.0");
+    send("id author Derran05W");
+    send("option name Hash type spin default 16 min 1 max 65536");
+    send("option name Threads type spin default 1 min 1 max 512");
+    send("option name Ponder type check default false");
+    send("option name EvalFile type string default <empty>");
+    send("option name BookFile type string default <empty>");
+    send("option name CacheFile type string default <empty>");
+    send("uciok");
+  }
+
+  int loop(bool handshakeReceived) {
+    Board board;
+    Search::onIteration(sendInfo);
+    if (handshakeReceived)
+      sendId();
+
+    std::string line, cmd;
+    while (std::getline(std::cin, line)) {
+      std::istringstream is(line);
+      cmd.clear();
+      is >> cmd;
+
+      if (cmd == "uci") {
+        sendId();
+      } else if (cmd == "isready") {
+        send("readyok");
+      } else if (cmd == "stop") {
+        Search::stop();
+        Search::wait();
+      } else if (cmd == "ponderhit") {
+        Search::ponderhit();
+      } else if (cmd == "quit") {
+        break;
+      } else if (cmd == "go" || cmd == "position" || cmd == "ucinewgame" || cmd == "setoption") {
+        // A search still running is finished first (GUIs send "stop" before these anyway)
+        Search::stop();
+        Search::wait();
+        if      (cmd == "go")         go(board, is);
+        else if (cmd == "position")   position(board, is);
+        else if (cmd == "ucinewgame") Search::clear();
+        else                          setOption(is);
+      } else if (cmd == "d") {
+        board.print();
+      } else if (!cmd.empty()) {
+        send("info string unknown command " + cmd);
+      }
+    }
+
+    Search::stop();
+    Search::wait();
+    return 0;
+  }
+}
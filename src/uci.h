@@ -0,0 +1,9 @@
+#pragma once
+
+namespace UCI {
+  // Reads UCI commands from stdin until "quit" or end of input. Searches run on a background
+  // thread (Search::start), so "stop", "ponderhit" and "isready" are answered while one runs.
+  // Pass handshakeReceived when the caller already consumed the opening "uci" line.
+  // Returns the process exit code.
+  int loop(bool handshakeReceived = false);
+}